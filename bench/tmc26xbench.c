@@ -0,0 +1,238 @@
+/* Host benchmark of the driver API. The driver is linked against a counting
+** transport so every SPI frame an API call produces is accounted for as well
+** as the time it takes.
+**
+** Build:
+**   make bench/tmc26xbench
+**
+** Usage: tmc26xbench [iterations]
+**
+** Output is one line per benchmark, tab separated and sorted as below, so two
+** runs can be compared with diff (frames and bytes are exact, ns are not):
+**   name	ns/op	frames/op	bytes/op
+** The planner benchmarks queue one segment per op, so planning throughput in
+** segments/s is 1e9 / ns/op.
+*/
+#define _POSIX_C_SOURCE 199309L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_planner.h"
+
+static unsigned long frames;
+
+// Counts frames, answers with an all-zero status
+static uint32_t countingTransport(TMC26XConfiguration* config, uint32_t command) {
+	(void)config;
+	(void)command;
+	frames++;
+	return 0;
+}
+
+typedef struct {
+	const char* name;
+	void (*setup)(TMC26XConfiguration* config);
+	void (*op)(TMC26XConfiguration* config);
+} Benchmark;
+
+static void setupProfile(TMC26XConfiguration* config) {
+	initializeTMC26XWithProfile(config, MOTOR_LG_23HS7430);
+}
+
+static void setupNone(TMC26XConfiguration* config) {
+	(void)config;
+}
+
+static void setupStationary(TMC26XConfiguration* config) {
+	setupProfile(config);
+	tmc26xSetStationaryCurrent(config);
+}
+
+static void setupDriving(TMC26XConfiguration* config) {
+	setupProfile(config);
+	tmc26xSetDrivingCurrent(config);
+}
+
+static void opProfileInit(TMC26XConfiguration* config) {
+	initializeTMC26XWithProfile(config, MOTOR_LG_23HS7430);
+}
+
+// Alternate between the two currents so every call is a real switch
+static void opCurrentSwitch(TMC26XConfiguration* config) {
+	tmc26xSetDrivingCurrent(config);
+	tmc26xSetStationaryCurrent(config);
+}
+
+// Same current again. The setters mark SGCSCONF and DRVCONF dirty whether or
+// not the value changed, so this still costs the two frames of a switch.
+static void opCurrentRepeat(TMC26XConfiguration* config) {
+	tmc26xSetDrivingCurrent(config);
+}
+
+static void opFullScaleCurrent(TMC26XConfiguration* config) {
+	tmc26xSetFullScaleCurrent(config, config->drivingCurrent);
+}
+
+static void opReadStallGuard(TMC26XConfiguration* config) {
+	tmc26xReadStallGuardValue(config);
+}
+
+static void opReadMicroStep(TMC26XConfiguration* config) {
+	tmc26xReadMicroStepValue(config);
+}
+
+static void opReadCoolStep(TMC26XConfiguration* config) {
+	tmc26xReadCoolStepValue(config);
+}
+
+// Readback selection changes on every call
+static void opReadAlternating(TMC26XConfiguration* config) {
+	tmc26xReadStallGuardValue(config);
+	tmc26xReadCoolStepValue(config);
+}
+
+static void opReadRaw(TMC26XConfiguration* config) {
+	tmc26xReadRaw(config);
+}
+
+static void commitDirty(TMC26XConfiguration* config, uint8_t dirty) {
+	config->dirty = dirty;
+	tmc26xCommitConfiguration(config, 0);
+}
+
+static void opCommitClean(TMC26XConfiguration* config) {
+	commitDirty(config, 0);
+}
+
+static void opCommitDRVCTRL(TMC26XConfiguration* config) {
+	commitDirty(config, TMC26X_DIRTY_BITMASK_DRVCTRL);
+}
+
+static void opCommitCHOPCONF(TMC26XConfiguration* config) {
+	commitDirty(config, TMC26X_DIRTY_BITMASK_CHOPCONF);
+}
+
+static void opCommitSGCSCONF(TMC26XConfiguration* config) {
+	commitDirty(config, TMC26X_DIRTY_BITMASK_SGCSCONF);
+}
+
+static void opCommitCurrent(TMC26XConfiguration* config) {
+	commitDirty(config, TMC26X_DIRTY_BITMASK_SGCSCONF | TMC26X_DIRTY_BITMASK_DRVCONF);
+}
+
+static void opCommitAll(TMC26XConfiguration* config) {
+	commitDirty(config, TMC26X_DIRTY_BITMASK_DRVCTRL | TMC26X_DIRTY_BITMASK_CHOPCONF
+		| TMC26X_DIRTY_BITMASK_SMARTEN | TMC26X_DIRTY_BITMASK_SGCSCONF | TMC26X_DIRTY_BITMASK_DRVCONF);
+}
+
+// Setter followed by a commit, the usual pattern in application code
+static void opSetThresholdCommit(TMC26XConfiguration* config) {
+	tmc26xSGCSCONFSetStallGuardThreshold(config, 5);
+	tmc26xCommitConfiguration(config, 0);
+}
+
+static TMC26XPlanner planner;
+static TMC26XStepGenerator generator;
+static unsigned int segment;
+
+static void setupPlanner(TMC26XConfiguration* config) {
+	(void)config;
+	tmc26xPlannerInit(&planner, 205);
+	tmc26xStepGeneratorInit(&generator, &planner);
+	segment = 0;
+}
+
+// Queues a segment, retiring the oldest when the ring is full as the step
+// generator would, so every op replans a full look-ahead window
+static void planSegment(const int32_t* steps) {
+	if (tmc26xPlannerAdd(&planner, steps, 20000, 100000) == TMC26X_QUEUE_FULL) {
+		tmc26xStepGeneratorStart(&generator);
+		tmc26xStepGeneratorDone(&generator);
+		tmc26xPlannerAdd(&planner, steps, 20000, 100000);
+	}
+}
+
+// Short chords of a circle, two axes, every junction slightly bent
+static void opPlannerCurve(TMC26XConfiguration* config) {
+	(void)config;
+	static const int32_t chords[8][TMC26X_PLANNER_AXES] = {
+		{200, 40}, {170, 113}, {113, 170}, {40, 200},
+		{-40, 200}, {-113, 170}, {-170, 113}, {-200, 40}
+	};
+
+	planSegment(chords[segment++ & 7]);
+}
+
+// Long moves of four axes with sharp corners
+static void opPlannerCorners(TMC26XConfiguration* config) {
+	(void)config;
+	static const int32_t moves[4][TMC26X_PLANNER_AXES] = {
+		{4000, 0, 1000, -200}, {0, 4000, -1000, 200},
+		{-4000, 0, 1000, -200}, {0, -4000, -1000, 200}
+	};
+
+	planSegment(moves[segment++ & 3]);
+}
+
+static const Benchmark benchmarks[] = {
+	{"profile_init",            setupNone,       opProfileInit},
+	{"current_switch_pair",     setupStationary, opCurrentSwitch},
+	{"current_repeat",          setupDriving,    opCurrentRepeat},
+	{"full_scale_current",      setupProfile,    opFullScaleCurrent},
+	{"read_stallguard",         setupProfile,    opReadStallGuard},
+	{"read_microstep",          setupProfile,    opReadMicroStep},
+	{"read_coolstep",           setupProfile,    opReadCoolStep},
+	{"read_alternating_pair",   setupProfile,    opReadAlternating},
+	{"read_raw",                setupProfile,    opReadRaw},
+	{"commit_clean",            setupProfile,    opCommitClean},
+	{"commit_drvctrl",          setupProfile,    opCommitDRVCTRL},
+	{"commit_chopconf",         setupProfile,    opCommitCHOPCONF},
+	{"commit_sgcsconf",         setupProfile,    opCommitSGCSCONF},
+	{"commit_sgcsconf_drvconf", setupProfile,    opCommitCurrent},
+	{"commit_all",              setupProfile,    opCommitAll},
+	{"set_threshold_commit",    setupProfile,    opSetThresholdCommit},
+	{"planner_curve",           setupPlanner,    opPlannerCurve},
+	{"planner_corners",         setupPlanner,    opPlannerCorners}
+};
+
+static double now_ns(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char** argv) {
+	TMC26XConfiguration config;
+	unsigned long iterations = 100000, i;
+	unsigned int b;
+	double start, elapsed;
+
+	if (argc > 1)
+		iterations = strtoul(argv[1], 0, 0);
+	if (iterations == 0)
+		return 1;
+
+	tmc26xHostTransport = countingTransport;
+
+	printf("# name\tns/op\tframes/op\tbytes/op\n");
+	for (b=0; b<sizeof(benchmarks)/sizeof(benchmarks[0]); b++) {
+		TMC26XConfiguration_Init(&config);
+		benchmarks[b].setup(&config);
+
+		frames = 0;
+		start = now_ns();
+		for (i=0; i<iterations; i++)
+			benchmarks[b].op(&config);
+		elapsed = now_ns() - start;
+
+		// Each frame is 20 bits clocked as three bytes
+		printf("%s\t%.1f\t%.2f\t%.2f\n", benchmarks[b].name, elapsed / iterations,
+			(double)frames / iterations, 3.0 * frames / iterations);
+	}
+
+	return 0;
+}
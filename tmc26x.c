@@ -32,104 +32,216 @@ static int8_t tmc26xCalcCSValue(uint16_t RMSCurrent_mA, uint16_t RSense_mOhm, ui
 	return tmp;
 }
 
+// Set by tmc26xEmergencyStop, while set no normal traffic is sent to any driver
+volatile uint8_t tmc26xEmergencyStopped = 0;
+
+// Axis whose chip select is currently asserted by the normal path, or
+// TMC26X_NO_AXIS. Used by tmc26xEmergencyStop to finish an interrupted frame.
+volatile uint8_t tmc26xActiveAxis = TMC26X_NO_AXIS;
+
+// Sees every frame sent by the driver, including the emergency stop's
+TMC26XFrameHook tmc26xFrameHook = 0;
+
 #ifndef UNIT_TESTING
 #include "util.h"
 #include "tmc26x_arch.h"
 
+/* Publishes the axis about to be clocked and asserts its chip select, unless
+** an emergency stop is latched. Done with interrupts disabled so a stop sees
+** either no transfer at all or the axis with its chip select asserted, which
+** it completes and releases.
+**
+** config - Configuration structure of the axis
+**
+** returns - 1 if the axis is selected, 0 if the bus is stopped
+*/
+static uint8_t tmc26xSelectAxis(TMC26XConfiguration* config) {
+	uint8_t selected = 0;
+	tmc26xCriticalBegin();
+
+	if (!tmc26xEmergencyStopped) {
+		tmc26xActiveAxis = config->axis;
+		tmc26xSPIAxisChipEnable(config->axis);
+		selected = 1;
+	}
+
+	tmc26xCriticalEnd();
+	return selected;
+}
+
 /* Sends a command, expressed as a 32-bit number down the line to the TMC26x
-** as an MSB 20-bit value
+** as an MSB 20-bit value. Nothing is sent while an emergency stop is latched
+** and a transfer interrupted by tmc26xEmergencyStop is abandoned.
 **
+** config  - Configuration structure (needed only for the axis to select)
 ** command - The 32-bit expresed command to send
 ** 
 ** returns - 20-bit return value as specified in data-sheet section 6.5
 */
-void tmc26xSendCommand(uint32_t command) {
-	tmc26xSPIChipEnable();
+uint32_t tmc26xSendCommand(TMC26XConfiguration* config, uint32_t command) {
+	uint32_t build = 0;
+
+	if (!tmc26xSelectAxis(config))
+		return 0;
 	
-	tmc26xSPITransceiveByte(BYTE2(command));
-	tmc26xSPITransceiveByte(BYTE1(command));
-	tmc26xSPITransceiveByte(BYTE0(command));
+	build  = tmc26xSPITransceiveFrame(config->axis, BYTE2(command), BYTE1(command), BYTE0(command));
+	build>>=4;
 
-	tmc26xSPIChipDisable();
+	// If an emergency stop fired part way through, it has already finished
+	// this frame with the stop frame and released the chip select. The chip
+	// latched the stop frame instead, so this one is not passed to the hook.
+	if (!tmc26xEmergencyStopped) {
+		tmc26xSPIAxisChipDisable(config->axis);
+		if (tmc26xFrameHook)
+			tmc26xFrameHook(config, command & 0xFFFFF, build);
+	}
+	tmc26xActiveAxis = TMC26X_NO_AXIS;
+	return build;
 }
 
-/* Reads the currently set readback value from the TMC26X chip, this should
-** previously have been set by writing the register DRVCONF to the chip.
-** note that this will nearly always be done with one of the helper functions
-** defined for each of the readback types.
+/* Sends a command already serialized as its three big-endian wire bytes
+** (see tmc26x_fast.h). Same rules as tmc26xSendCommand, without splitting
+** the register on every call.
 **
-** config - Configuration structure (needed only for current regDRVCONF)
+** config - Configuration structure (needed only for the axis to select)
+** frame  - the three bytes to send
 **
-** returns - the 20-bit value (correctly shifted) read from the chip.
+** returns - 20-bit return value as specified in data-sheet section 6.5
 */
-uint32_t tmc26xReadback(TMC26XConfiguration* config) {
+uint32_t tmc26xSendSerialized(TMC26XConfiguration* config, const uint8_t* frame) {
 	uint32_t build = 0;
 
-	tmc26xSPIChipEnable();
-	
-	build  = tmc26xSPITransceiveByte(BYTE2(config->regDRVCONF));
-	build<<=8;
-	build |= tmc26xSPITransceiveByte(BYTE1(config->regDRVCONF));
-	build<<=8;
-	build |= tmc26xSPITransceiveByte(BYTE0(config->regDRVCONF));
+	if (!tmc26xSelectAxis(config))
+		return 0;
+
+	build  = tmc26xSPITransceiveFrame(config->axis, frame[0], frame[1], frame[2]);
 	build>>=4;
-	tmc26xSPIChipDisable();
+
+	if (!tmc26xEmergencyStopped) {
+		tmc26xSPIAxisChipDisable(config->axis);
+		if (tmc26xFrameHook)
+			tmc26xFrameHook(config, ((uint32_t)frame[0] << 16 | (uint32_t)frame[1] << 8 | frame[2]) & 0xFFFFF, build);
+	}
+	tmc26xActiveAxis = TMC26X_NO_AXIS;
 	return build;
 }
 
 #else
-uint32_t tmc26xSendCommand(uint32_t command) {
+/* Default host transport, prints each frame
+*/
+static uint32_t tmc26xPrintCommand(TMC26XConfiguration* config, uint32_t command) {
+	(void)config;
 	printf("%05X\n",command);
 	return 0;
 }
 
+// Host builds send every frame through this hook so that benchmarks, tracing
+// and chip emulation can stand in for the SPI bus.
+TMC26XHostTransport tmc26xHostTransport = tmc26xPrintCommand;
+
+uint32_t tmc26xSendCommand(TMC26XConfiguration* config, uint32_t command) {
+	uint32_t response;
+
+	if (tmc26xEmergencyStopped)
+		return 0;
+
+	response = tmc26xHostTransport(config, command & 0xFFFFF);
+	if (tmc26xFrameHook)
+		tmc26xFrameHook(config, command & 0xFFFFF, response);
+	return response;
+}
+
+uint32_t tmc26xSendSerialized(TMC26XConfiguration* config, const uint8_t* frame) {
+	return tmc26xSendCommand(config, ((uint32_t)frame[0] << 16) | ((uint32_t)frame[1] << 8) | frame[2]);
+}
+
 #endif
 
+/* Reads the currently set readback value from the TMC26X chip, this should
+** previously have been set by writing the register DRVCONF to the chip.
+** note that this will nearly always be done with one of the helper functions
+** defined for each of the readback types.
+**
+** config - Configuration structure (needed only for current regDRVCONF)
+**
+** returns - the 20-bit value (correctly shifted) read from the chip.
+*/
+uint32_t tmc26xReadback(TMC26XConfiguration* config) {
+	return tmc26xSendCommand(config, config->regDRVCONF);
+}
+
+/* Pre-serializes a committed CHOPCONF value as the frames used by
+** tmc26xEmergencyStop (TOFF = 0, bridges off) and tmc26xEmergencyRelease.
+** Called by anything that writes CHOPCONF to the chip.
+**
+** config   - Configuration structure
+** chopconf - the CHOPCONF value just sent
+*/
+void tmc26xSerializeStopFrames(TMC26XConfiguration* config, uint32_t chopconf) {
+	uint32_t stop = chopconf & ~(uint32_t)0x0F;
+
+	config->runFrame[0] = (uint8_t)(chopconf >> 16);
+	config->runFrame[1] = (uint8_t)(chopconf >> 8);
+	config->runFrame[2] = (uint8_t)chopconf;
+	config->stopFrame[0] = (uint8_t)(stop >> 16);
+	config->stopFrame[1] = (uint8_t)(stop >> 8);
+	config->stopFrame[2] = (uint8_t)stop;
+}
+
 /* Commits the configuration structure to the TMC26X chip itself
 **
 ** config - Configuration structure
 **
-** returns TMC26X_SUCCESS if valid otherwise TMC26X_INVALID_CONFIG
+** returns TMC26X_SUCCESS if valid otherwise TMC26X_INVALID_CONFIG, or
+**         TMC26X_EMERGENCY_STOP if an emergency stop is latched (the dirty
+**         registers are then kept for a later commit)
 */
 int tmc26xCommitConfiguration(TMC26XConfiguration* config, int SGCSCONFFirst) {
 	if (config->validity != 0xFFFFFFFF)
 		return TMC26X_INVALID_CONFIG;
 
+	if (tmc26xEmergencyStopped)
+		return TMC26X_EMERGENCY_STOP;
+
 	if (SGCSCONFFirst == 1 && (config->dirty & TMC26X_DIRTY_BITMASK_SGCSCONF))
-		tmc26xSendCommand(config->regSGCSCONF);
+		tmc26xSendCommand(config, config->regSGCSCONF);
 	
 	if (config->dirty & TMC26X_DIRTY_BITMASK_DRVCONF)
-		tmc26xSendCommand(config->regDRVCONF);
+		tmc26xSendCommand(config, config->regDRVCONF);
 
 	if (SGCSCONFFirst == 0 && (config->dirty & TMC26X_DIRTY_BITMASK_SGCSCONF))
-		tmc26xSendCommand(config->regSGCSCONF);
+		tmc26xSendCommand(config, config->regSGCSCONF);
 
 	if (config->dirty & TMC26X_DIRTY_BITMASK_DRVCTRL)
-		tmc26xSendCommand(config->regDRVCTRL);
+		tmc26xSendCommand(config, config->regDRVCTRL);
 		
-	if (config->dirty & TMC26X_DIRTY_BITMASK_CHOPCONF)
-		tmc26xSendCommand(config->regCHOPCONF);
+	if (config->dirty & TMC26X_DIRTY_BITMASK_CHOPCONF) {
+		tmc26xSendCommand(config, config->regCHOPCONF);
+		tmc26xSerializeStopFrames(config, config->regCHOPCONF);
+	}
 		
 	if (config->dirty & TMC26X_DIRTY_BITMASK_SMARTEN)
-		tmc26xSendCommand(config->regSMARTEN);
+		tmc26xSendCommand(config, config->regSMARTEN);
+
+	// A stop fired during the commit, keep everything dirty for a replay
+	if (tmc26xEmergencyStopped)
+		return TMC26X_EMERGENCY_STOP;
 	
 	config->dirty = 0;
 
 	return TMC26X_SUCCESS;
 }
 
-/* Sets the maximum current based on the VSENSE, RSENSE and desired current
-** This will calculate and commit to chip, the values for CS and VSENSE
-** in SGCSCONF and DRVCONF registers respectively.
+/* Calculates and sets, in the configuration structure only, the values for
+** CS and VSENSE in SGCSCONF and DRVCONF registers respectively for the desired
+** current. Used by tmc26xSetFullScaleCurrent and the non-blocking operations.
 **
 ** config - Current configuration structure
 **
-** returns - TMC26X_SUCCESS if everything goes well, otherwise the
-**           TMC26X_INVALID_VALUE if the current cannot be computer
-**           or TMC26X_INVALID_CONFIG if there were other configuration
-**           problems
+** returns - 1 if SGCSCONF must be committed before DRVCONF, 0 if after,
+**           otherwise TMC26X_INVALID_VALUE if the current cannot be computed
 */
-int tmc26xSetFullScaleCurrent(TMC26XConfiguration* config, uint16_t current_mA) {
+int tmc26xPrepareFullScaleCurrent(TMC26XConfiguration* config, uint16_t current_mA) {
 	uint16_t VSense, oldVSense;
 	int8_t currentSetting;
 
@@ -159,13 +271,31 @@ int tmc26xSetFullScaleCurrent(TMC26XConfiguration* config, uint16_t current_mA)
 	// Set the new VSense value
 	tmc26xDRVCONFSetMaximumRSenseVoltage(config, VSense);
 
-	// Commit the new changes. For safety reasons, when scaling up to 305mV from 165mV
-	// the new current setting should be entered into the device first to prevent
-	// over-current (i.e. if old CS was 32, then going to 305 would be disastrous)
-	if (oldVSense == TMC26X_VSENSE_HALFISH && VSense == TMC26X_VSENSE_FULL)
-		return tmc26xCommitConfiguration(config, 1);
-	else
-		return tmc26xCommitConfiguration(config, 0);
+	// For safety reasons, when scaling up to 305mV from 165mV the new current
+	// setting should be entered into the device first to prevent over-current
+	// (i.e. if old CS was 32, then going to 305 would be disastrous)
+	return oldVSense == TMC26X_VSENSE_HALFISH && VSense == TMC26X_VSENSE_FULL;
+}
+
+/* Sets the maximum current based on the VSENSE, RSENSE and desired current
+** This will calculate and commit to chip, the values for CS and VSENSE
+** in SGCSCONF and DRVCONF registers respectively.
+**
+** config - Current configuration structure
+**
+** returns - TMC26X_SUCCESS if everything goes well, otherwise the
+**           TMC26X_INVALID_VALUE if the current cannot be computer
+**           or TMC26X_INVALID_CONFIG if there were other configuration
+**           problems
+*/
+int tmc26xSetFullScaleCurrent(TMC26XConfiguration* config, uint16_t current_mA) {
+	int SGCSCONFFirst;
+
+	if ((SGCSCONFFirst = tmc26xPrepareFullScaleCurrent(config, current_mA)) < 0)
+		return SGCSCONFFirst;
+
+	// Commit the new changes in the safe order
+	return tmc26xCommitConfiguration(config, SGCSCONFFirst);
 }
 
 /* Sets the maximum current based on the previously defined driving current
@@ -190,7 +320,6 @@ int tmc26xSetStationaryCurrent(TMC26XConfiguration* config) {
 	return tmc26xSetFullScaleCurrent(config, config->stationaryCurrent);
 }
 
-#ifndef UNIT_TESTING
 /* Read the stallguard value from the TMC chip over SPI. this will sync the
 ** current configuration structure if any of the dirty bits are set
 **
@@ -218,7 +347,8 @@ uint16_t tmc26xReadStallGuardValue(TMC26XConfiguration* config) {
 **
 ** config - Current configuration structure
 **
-** returns - the microstep value (8 bits)
+** returns - the microstep value (10 bits, position in the sine table for
+**           coil A; bit 9 is the coil A polarity)
 */
 uint16_t tmc26xReadMicroStepValue(TMC26XConfiguration* config) {
 	uint32_t tmp;
@@ -257,20 +387,15 @@ uint16_t tmc26xReadCoolStepValue(TMC26XConfiguration* config) {
 	return (uint16_t)tmp&0x1F;
 }
 
-/* Read the raw return from the TMC chip over SPI. this will sync the
-** current configuration structure if any of the dirty bits are set
+/* Read the raw return from the TMC chip over SPI, using the readback value
+** already selected. Nothing is written other than the readback itself.
 **
 ** config - Current configuration structure
 **
-** returns - the stallguard value (10 bits)
+** returns - the 20-bit response: readback value in bits 10-19 (laid out as
+**           selected by RDSEL), status flags in bits 0-7
 */
 uint32_t tmc26xReadRaw(TMC26XConfiguration* config) {
-	uint32_t tmp;
-
-	tmp = tmc26xReadback(config);
-	tmp >>= 4;
-
-	return (uint32_t)tmp;
+	return tmc26xReadback(config);
 }
-#endif
 
@@ -9,6 +9,9 @@ typedef struct {
 	uint32_t validity;
 	uint16_t stationaryCurrent;
 	uint16_t drivingCurrent;
+	uint8_t axis;
+	uint8_t stopFrame[3];
+	uint8_t runFrame[3];
 } TMC26XConfiguration;
 
 
@@ -21,6 +24,11 @@ enum {
 };
 
 
+enum {
+	TMC26X_NO_AXIS = 0xFF
+};
+
+
 // Structure for defining profiles on the motor
 typedef struct {
 	int profileID;
@@ -55,7 +63,13 @@ enum {
 	TMC26X_INVALID_MODE = -1,
 	TMC26X_INVALID_VALUE = -2,
 	TMC26X_INVALID_CONFIG = -3,
-	TMC26X_INVALID_PROFILE = -4
+	TMC26X_INVALID_PROFILE = -4,
+	TMC26X_INVALID_BLOB = -5,
+	TMC26X_CHIP_RESET = -6,
+	TMC26X_EMERGENCY_STOP = -7,
+	TMC26X_QUEUE_FULL = -8,
+	TMC26X_INVALID_TRACE = -9,
+	TMC26X_STEP_LOSS = -10
 };
 
 
@@ -67,13 +81,36 @@ enum {
 };
 
 
+#ifdef UNIT_TESTING
+// Host stand-in for the SPI bus: receives the 20-bit command, returns the
+// 20-bit response
+typedef uint32_t (*TMC26XHostTransport)(TMC26XConfiguration* config, uint32_t command);
+extern TMC26XHostTransport tmc26xHostTransport;
+#endif
+
+// Called with every frame the chip latched and its 20-bit response, e.g. to
+// record a trace (see tmc26x_trace.h). 0 when unused.
+typedef void (*TMC26XFrameHook)(TMC26XConfiguration* config, uint32_t command, uint32_t response);
+
+extern volatile uint8_t tmc26xEmergencyStopped;
+extern volatile uint8_t tmc26xActiveAxis;
+extern TMC26XFrameHook tmc26xFrameHook;
+extern TMC26XProfileStepDirSpreadCycle profiles[];
+extern const int tmc26xProfileCount;
+
+
 void TMC26XConfiguration_Init(TMC26XConfiguration* config);
 int tmc26xCommitConfiguration(TMC26XConfiguration* config, int SGCSCONFFirst);
+int tmc26xPrepareFullScaleCurrent(TMC26XConfiguration* config, uint16_t current_mA);
 int tmc26xSetFullScaleCurrent(TMC26XConfiguration* config, uint16_t current_mA);
 int tmc26xSetDrivingCurrent(TMC26XConfiguration* config);
 int tmc26xSetStationaryCurrent(TMC26XConfiguration* config);
 int initializeTMC26XWithProfile(TMC26XConfiguration* config, int motorProfile);
-uint32_t tmc26xReadBack(TMC26XConfiguration* config);
+int tmc26xRegisterProfile(const TMC26XProfileStepDirSpreadCycle* profile);
+uint32_t tmc26xSendCommand(TMC26XConfiguration* config, uint32_t command);
+uint32_t tmc26xSendSerialized(TMC26XConfiguration* config, const uint8_t* frame);
+void tmc26xSerializeStopFrames(TMC26XConfiguration* config, uint32_t chopconf);
+uint32_t tmc26xReadback(TMC26XConfiguration* config);
 uint16_t tmc26xReadStallGuardValue(TMC26XConfiguration* config);
 uint16_t tmc26xReadMicroStepValue(TMC26XConfiguration* config);
 uint16_t tmc26xReadCoolStepValue(TMC26XConfiguration* config);
@@ -1,22 +1,192 @@
 #ifdef ARCH_XMEGA
 #include <avr/io.h>
-#include <avr/interrupt.h> 
+#include <avr/interrupt.h>
 #include "io_assignment.h"
 
+#ifdef TMC26X_USART_SPI
+// Transport on XMEGA USARTs in Master SPI mode. The transmitter is double
+// buffered, so the three bytes of a frame go out back to back instead of with
+// a gap after each. Each USART is a separate bus: io_assignment.h maps an
+// axis to its USART with tmc26xAxisUSART(axis), or names a single one as
+// GLOBAL_TMC26X_USART. The USARTs are set up with tmc26xUSARTSPIConfigure;
+// SPI mode 3 also needs the XCK pin inverted (PINnCTRL INVEN), which is left
+// to the board code along with the pin directions.
+#ifndef tmc26xAxisUSART
+#define tmc26xAxisUSART(axis) (&GLOBAL_TMC26X_USART)
+#endif
+
+/* Sets up a USART as an SPI master for the TMC26X (mode 3, MSB first)
+**
+** usart    - the USART
+** clock_hz - SCK frequency, F_CPU / 2 at most. Can be changed at run time
+**            between frames
+*/
+static inline void tmc26xUSARTSPIConfigure(USART_t* usart, uint32_t clock_hz) {
+	uint32_t bsel = (F_CPU / 2 + clock_hz - 1) / clock_hz - 1;
+
+	if (bsel > 0xFFF)
+		bsel = 0xFFF;
+	usart->CTRLB = 0;
+	usart->BAUDCTRLA = (uint8_t)bsel;
+	usart->BAUDCTRLB = (uint8_t)(bsel >> 8);
+	usart->CTRLC = USART_CMODE_MSPI_gc | 0x02;     // UCPHA, data sampled on the trailing edge
+	usart->CTRLB = USART_RXEN_bm | USART_TXEN_bm;
+}
+
+// Waits for a USART flag, abandoned once an emergency stop has taken over the
+// bus unless blocking
+#define tmc26xUSARTWait(usart, flag, blocking) while(((usart)->STATUS & (flag)) == 0 && ((blocking) || !tmc26xEmergencyStopped))
+
+// Tells whether a frame has been abandoned to an emergency stop
+#define tmc26xUSARTAbandoned(blocking) (!(blocking) && tmc26xEmergencyStopped)
+
+/* Exchanges one frame. The second byte is queued while the first shifts and
+** the third as soon as the second starts, each received byte is picked up
+** while the next one shifts. A frame abandoned to an emergency stop writes
+** nothing more to DATA; what it left on the bus is drained by the stop and
+** by tmc26xEmergencyRelease.
+**
+** usart    - bus of the axis
+** b0..b2   - frame, first byte first
+** blocking - 1 for the emergency stop itself, never abandoned
+**
+** returns - the 24 bits received, 0 if abandoned
+*/
+static inline uint32_t USARTSPITransceiveFrame(USART_t* usart, uint8_t b0, uint8_t b1, uint8_t b2, uint8_t blocking) {
+	uint32_t build;
+
+	if (tmc26xUSARTAbandoned(blocking))
+		return 0;
+	usart->DATA = b0;
+	tmc26xUSARTWait(usart, USART_DREIF_bm, blocking);
+	if (tmc26xUSARTAbandoned(blocking))
+		return 0;
+	usart->DATA = b1;
+	tmc26xUSARTWait(usart, USART_RXCIF_bm, blocking);
+	build = usart->DATA;
+	tmc26xUSARTWait(usart, USART_DREIF_bm, blocking);
+	if (tmc26xUSARTAbandoned(blocking))
+		return 0;
+	usart->DATA = b2;
+	tmc26xUSARTWait(usart, USART_RXCIF_bm, blocking);
+	build = (build << 8) | usart->DATA;
+	tmc26xUSARTWait(usart, USART_RXCIF_bm, blocking);
+	build = (build << 8) | usart->DATA;
+	usart->STATUS = USART_TXCIF_bm;
+	return build;
+}
+#define tmc26xSPITransceiveFrame(axis, b0, b1, b2) USARTSPITransceiveFrame(tmc26xAxisUSART(axis), b0, b1, b2, 0)
+#define tmc26xSPITransceiveFrameBlocking(axis, b0, b1, b2) USARTSPITransceiveFrame(tmc26xAxisUSART(axis), b0, b1, b2, 1)
+
+// Waits for the bytes that may be queued on the axis' bus to finish (at most
+// two, 16 SCK periods of 2 * (BSEL + 1) CPU cycles) and discards what they
+// brought in.
+static inline void USARTSPIDrain(USART_t* usart) {
+	uint32_t spin = ((uint32_t)((usart->BAUDCTRLB & 0x0F) << 8 | usart->BAUDCTRLA) + 1) * 2 * 16 / 4;
+	while((usart->STATUS & USART_TXCIF_bm) == 0 && --spin);
+	while(usart->STATUS & USART_RXCIF_bm)
+		(void)usart->DATA;
+	usart->STATUS = USART_TXCIF_bm;
+}
+#define tmc26xSPIDrain(axis) USARTSPIDrain(tmc26xAxisUSART(axis))
+
+#define tmc26xSPIChipEnable() GLOBAL_TMC26X_SPI_SELECT_PORT.OUTCLR = GLOBAL_TMC26X_SPI_SELECT_PIN
+#define tmc26xSPIChipDisable() GLOBAL_TMC26X_SPI_SELECT_PORT.OUTSET = GLOBAL_TMC26X_SPI_SELECT_PIN
+#else
+// SCK of the SPI peripheral, boards may define it (e.g. as a variable to
+// change it at run time)
+#ifndef TMC26X_SPI_PRESCALER
+#define TMC26X_SPI_PRESCALER SPI_PRESCALER_DIV16_gc
+#endif
+
+// Transfers abandon their wait once an emergency stop has taken over the bus,
+// and write nothing more to DATA after it
 static inline uint8_t SPITransceiveByte(uint8_t data) {
+	if (tmc26xEmergencyStopped)
+		return 0;
 	GLOBAL_TMC26X_SPI_CONTROLLER.DATA = data;      // initiate write
-	while((GLOBAL_TMC26X_SPI_CONTROLLER.STATUS & SPI_IF_bm) == 0);
+	while((GLOBAL_TMC26X_SPI_CONTROLLER.STATUS & SPI_IF_bm) == 0 && !tmc26xEmergencyStopped);
 	return GLOBAL_TMC26X_SPI_CONTROLLER.DATA;
 }
 #define tmc26xSPITransceiveByte SPITransceiveByte
-	
-#define tmc26xSPIChipEnable() GLOBAL_TMC26X_SPI_CONTROLLER.CTRL = SPI_ENABLE_bm | SPI_MASTER_bm | SPI_MODE_3_gc | SPI_PRESCALER_DIV16_gc; GLOBAL_TMC26X_SPI_SELECT_PORT.OUTCLR = GLOBAL_TMC26X_SPI_SELECT_PIN
+
+// Used by the emergency stop itself, never abandoned
+static inline uint8_t SPITransceiveByteBlocking(uint8_t data) {
+	GLOBAL_TMC26X_SPI_CONTROLLER.DATA = data;      // initiate write
+	while((GLOBAL_TMC26X_SPI_CONTROLLER.STATUS & SPI_IF_bm) == 0);
+	return GLOBAL_TMC26X_SPI_CONTROLLER.DATA;
+}
+#define tmc26xSPITransceiveByteBlocking SPITransceiveByteBlocking
+
+// Waits for a byte that may be in flight to finish (at most 8 SPI clocks of
+// the prescaler currently set, F_CPU / 2 .. F_CPU / 128, i.e. 8 * divisor CPU
+// cycles) and clears the interrupt and write collision flags.
+static inline void SPIDrain(void) {
+	uint8_t ctrl = GLOBAL_TMC26X_SPI_CONTROLLER.CTRL;
+	uint16_t divisor = (ctrl & SPI_PRESCALER_gm) == SPI_PRESCALER_gm ? 128 : 4 << ((ctrl & SPI_PRESCALER_gm) * 2);
+	uint16_t spin;
+
+	if (ctrl & SPI_CLK2X_bm)
+		divisor /= 2;
+	spin = divisor * 8 / 4;
+	while((GLOBAL_TMC26X_SPI_CONTROLLER.STATUS & SPI_IF_bm) == 0 && --spin);
+	(void)GLOBAL_TMC26X_SPI_CONTROLLER.DATA;
+}
+#define tmc26xSPIDrain(axis) SPIDrain()
+
+#define tmc26xSPIChipEnable() GLOBAL_TMC26X_SPI_CONTROLLER.CTRL = SPI_ENABLE_bm | SPI_MASTER_bm | SPI_MODE_3_gc | TMC26X_SPI_PRESCALER; GLOBAL_TMC26X_SPI_SELECT_PORT.OUTCLR = GLOBAL_TMC26X_SPI_SELECT_PIN
 #define tmc26xSPIChipDisable() GLOBAL_TMC26X_SPI_SELECT_PORT.OUTSET = GLOBAL_TMC26X_SPI_SELECT_PIN
+#endif
+
+#define tmc26xCriticalBegin() uint8_t tmc26xSavedSREG = SREG; cli()
+#define tmc26xCriticalEnd() SREG = tmc26xSavedSREG
 #else
 static inline uint8_t SPITransceiveByte(uint8_t data) {
+	(void)data;
+	return 0;
 }
 #define tmc26xSPITransceiveByte SPITransceiveByte
-	
-#define tmc26xSPIChipEnable() 1+1
-#define tmc26xSPIChipDisable() 1+1
+#define tmc26xSPITransceiveByteBlocking SPITransceiveByte
+#define tmc26xSPIDrain(axis) ((void)0)
+
+#define tmc26xSPIChipEnable() ((void)0)
+#define tmc26xSPIChipDisable() ((void)0)
+
+#define tmc26xCriticalBegin() ((void)0)
+#define tmc26xCriticalEnd() ((void)0)
+#endif
+
+// Byte at a time frames for the SPI peripheral, which has no transmit buffer
+#ifndef tmc26xSPITransceiveFrame
+static inline uint32_t SPITransceiveFrame(uint8_t b0, uint8_t b1, uint8_t b2) {
+	uint32_t build;
+
+	build  = tmc26xSPITransceiveByte(b0);
+	build<<=8;
+	build |= tmc26xSPITransceiveByte(b1);
+	build<<=8;
+	build |= tmc26xSPITransceiveByte(b2);
+	return build;
+}
+#define tmc26xSPITransceiveFrame(axis, b0, b1, b2) SPITransceiveFrame(b0, b1, b2)
+
+static inline uint32_t SPITransceiveFrameBlocking(uint8_t b0, uint8_t b1, uint8_t b2) {
+	uint32_t build;
+
+	build  = tmc26xSPITransceiveByteBlocking(b0);
+	build<<=8;
+	build |= tmc26xSPITransceiveByteBlocking(b1);
+	build<<=8;
+	build |= tmc26xSPITransceiveByteBlocking(b2);
+	return build;
+}
+#define tmc26xSPITransceiveFrameBlocking(axis, b0, b1, b2) SPITransceiveFrameBlocking(b0, b1, b2)
+#endif
+
+// Boards with several drivers on the bus define these in io_assignment.h to
+// select the chip belonging to config->axis. Single driver boards use the
+// global chip select.
+#ifndef tmc26xSPIAxisChipEnable
+#define tmc26xSPIAxisChipEnable(axis) tmc26xSPIChipEnable()
+#define tmc26xSPIAxisChipDisable(axis) tmc26xSPIChipDisable()
 #endif
@@ -0,0 +1,186 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_blob.h"
+
+/* Advances a CRC16-CCITT (polynomial 0x1021) by one byte. Start with 0xFFFF.
+**
+** crc  - running CRC value
+** data - next byte of the blob
+**
+** returns - the updated CRC value
+*/
+uint16_t tmc26xBlobCRC16(uint16_t crc, uint8_t data) {
+	uint8_t i;
+
+	crc ^= (uint16_t)data << 8;
+	for (i=0; i<8; i++) {
+		if (crc & 0x8000)
+			crc = (crc << 1) ^ 0x1021;
+		else
+			crc <<= 1;
+	}
+
+	return crc;
+}
+
+/* Reader for blobs held in RAM (e.g. a host file read into a buffer or a
+** blob received over a serial link).
+**
+** source  - pointer to the start of the buffer
+** address - offset into the buffer
+**
+** returns - the byte at that offset
+*/
+uint8_t tmc26xBlobMemoryReader(const void* source, uint16_t address) {
+	return ((const uint8_t*)source)[address];
+}
+
+/* Serializes a profile into a version 1 blob, including header and CRC.
+**
+** profile - profile to serialize
+** out     - buffer of at least TMC26X_BLOB_MAX_SIZE bytes
+**
+** returns - the number of bytes written to out
+*/
+uint16_t tmc26xBlobWrite(const TMC26XProfileStepDirSpreadCycle* profile, uint8_t* out) {
+	uint16_t i = 0, crc = 0xFFFF, n;
+
+	out[i++] = TMC26X_BLOB_MAGIC0;
+	out[i++] = TMC26X_BLOB_MAGIC1;
+	out[i++] = TMC26X_BLOB_VERSION;
+	out[i++] = TMC26X_BLOB_PAYLOAD_SIZE_V1;
+
+	out[i++] = (uint8_t)profile->profileID;
+	out[i++] = (uint8_t)(profile->profileID >> 8);
+	out[i++] = profile->stepInterpolation;
+	out[i++] = profile->doubleEdge;
+	out[i++] = (uint8_t)profile->microStepResolution;
+	out[i++] = (uint8_t)(profile->microStepResolution >> 8);
+	out[i++] = profile->blankingTime;
+	out[i++] = profile->randomTOff;
+	out[i++] = profile->timeOff;
+	out[i++] = profile->hysteresisDecrement;
+	out[i++] = profile->hysteresisStart;
+	out[i++] = (uint8_t)profile->hysteresisEnd;
+	out[i++] = profile->minCoolStepCurrent;
+	out[i++] = profile->currentDecSpeed;
+	out[i++] = profile->highCoolStepThreshold;
+	out[i++] = profile->currentIncSize;
+	out[i++] = profile->lowCoolStepThreshold;
+	out[i++] = profile->stallGuardFilter;
+	out[i++] = (uint8_t)profile->stallGuardThreshold;
+	out[i++] = profile->testMode;
+	out[i++] = profile->slopeControlHigh;
+	out[i++] = profile->slopeControlLow;
+	out[i++] = profile->groundShortProtection;
+	out[i++] = profile->groundShortTimer;
+	out[i++] = (uint8_t)profile->highCurrent;
+	out[i++] = (uint8_t)(profile->highCurrent >> 8);
+	out[i++] = (uint8_t)profile->lowCurrent;
+	out[i++] = (uint8_t)(profile->lowCurrent >> 8);
+
+	for (n=0; n<i; n++)
+		crc = tmc26xBlobCRC16(crc, out[n]);
+	out[i++] = (uint8_t)crc;
+	out[i++] = (uint8_t)(crc >> 8);
+
+	return i;
+}
+
+/* Reads and verifies a single blob, decoding it into a profile structure.
+** The CRC is checked before any field is decoded, so a corrupt blob never
+** produces a partially filled profile. Payloads longer than the version 1
+** size are accepted and the trailing fields ignored.
+**
+** reader  - byte reader for the storage holding the blob
+** source  - passed through to reader
+** address - address of the first byte ('T') of the blob
+** profile - profile structure to fill in
+**
+** returns - TMC26X_SUCCESS or TMC26X_INVALID_BLOB if the header, version,
+**           length or CRC do not check out
+*/
+int tmc26xBlobRead(TMC26XBlobReader reader, const void* source, uint16_t address, TMC26XProfileStepDirSpreadCycle* profile) {
+	uint16_t crc = 0xFFFF, n, length;
+	uint16_t a = address + TMC26X_BLOB_HEADER_SIZE;
+
+	if (reader(source, address) != TMC26X_BLOB_MAGIC0
+	 || reader(source, address + 1) != TMC26X_BLOB_MAGIC1
+	 || reader(source, address + 2) != TMC26X_BLOB_VERSION)
+		return TMC26X_INVALID_BLOB;
+
+	length = reader(source, address + 3);
+	if (length < TMC26X_BLOB_PAYLOAD_SIZE_V1)
+		return TMC26X_INVALID_BLOB;
+
+	for (n=0; n<TMC26X_BLOB_HEADER_SIZE + length; n++)
+		crc = tmc26xBlobCRC16(crc, reader(source, address + n));
+	if (reader(source, address + n) != (uint8_t)crc
+	 || reader(source, address + n + 1) != (uint8_t)(crc >> 8))
+		return TMC26X_INVALID_BLOB;
+
+	profile->profileID              = reader(source, a) | ((int)reader(source, a + 1) << 8);
+	profile->stepInterpolation      = reader(source, a + 2);
+	profile->doubleEdge             = reader(source, a + 3);
+	profile->microStepResolution    = reader(source, a + 4) | ((uint16_t)reader(source, a + 5) << 8);
+	profile->blankingTime           = reader(source, a + 6);
+	profile->randomTOff             = reader(source, a + 7);
+	profile->timeOff                = reader(source, a + 8);
+	profile->hysteresisDecrement    = reader(source, a + 9);
+	profile->hysteresisStart        = reader(source, a + 10);
+	profile->hysteresisEnd          = (int8_t)reader(source, a + 11);
+	profile->minCoolStepCurrent     = reader(source, a + 12);
+	profile->currentDecSpeed        = reader(source, a + 13);
+	profile->highCoolStepThreshold  = reader(source, a + 14);
+	profile->currentIncSize         = reader(source, a + 15);
+	profile->lowCoolStepThreshold   = reader(source, a + 16);
+	profile->stallGuardFilter       = reader(source, a + 17);
+	profile->stallGuardThreshold    = (int8_t)reader(source, a + 18);
+	profile->testMode               = reader(source, a + 19);
+	profile->slopeControlHigh       = reader(source, a + 20);
+	profile->slopeControlLow        = reader(source, a + 21);
+	profile->groundShortProtection  = reader(source, a + 22);
+	profile->groundShortTimer       = reader(source, a + 23);
+	profile->highCurrent            = reader(source, a + 24) | ((uint16_t)reader(source, a + 25) << 8);
+	profile->lowCurrent             = reader(source, a + 26) | ((uint16_t)reader(source, a + 27) << 8);
+
+	return TMC26X_SUCCESS;
+}
+
+/* Walks an image of back to back blobs and registers each one so that it
+** can be selected through initializeTMC26XWithProfile. Walking stops at the
+** end of the image or at the first byte that is not a blob header.
+**
+** reader  - byte reader for the storage holding the image
+** source  - passed through to reader
+** address - address of the first blob
+** length  - size of the image storage in bytes
+**
+** returns - the number of profiles registered, TMC26X_INVALID_BLOB if a blob
+**           fails its check or TMC26X_INVALID_PROFILE if the registry is full
+*/
+int tmc26xBlobLoadImage(TMC26XBlobReader reader, const void* source, uint16_t address, uint16_t length) {
+	TMC26XProfileStepDirSpreadCycle profile;
+	uint32_t position = address, end = (uint32_t)address + length;
+	int count = 0, result;
+
+	// Checked in 32 bits so nothing wraps; the reader addresses 64K at most
+	if (end > 0x10000)
+		end = 0x10000;
+
+	while (position + TMC26X_BLOB_HEADER_SIZE <= end && reader(source, position) == TMC26X_BLOB_MAGIC0) {
+		if (position + TMC26X_BLOB_HEADER_SIZE + reader(source, position + 3) + TMC26X_BLOB_CRC_SIZE > end)
+			return TMC26X_INVALID_BLOB;
+
+		if ((result = tmc26xBlobRead(reader, source, position, &profile)) != TMC26X_SUCCESS)
+			return result;
+
+		if ((result = tmc26xRegisterProfile(&profile)) != TMC26X_SUCCESS)
+			return result;
+
+		position += TMC26X_BLOB_HEADER_SIZE + reader(source, position + 3) + TMC26X_BLOB_CRC_SIZE;
+		count++;
+	}
+
+	return count;
+}
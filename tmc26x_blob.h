@@ -0,0 +1,31 @@
+// Binary profile blob format (little-endian)
+//
+// offset 0   - 'T'
+// offset 1   - 'P'
+// offset 2   - format version (TMC26X_BLOB_VERSION)
+// offset 3   - payload length in bytes
+// offset 4   - payload, fields in TMC26XProfileStepDirSpreadCycle order
+// offset 4+n - CRC16-CCITT (poly 0x1021, init 0xFFFF) over bytes 0 .. 3+n
+//
+// Several blobs may be stored back to back to form an image, which is
+// terminated by the first byte that is not a 'T' (erased EEPROM/flash reads 0xFF).
+enum {
+	TMC26X_BLOB_MAGIC0 = 'T',
+	TMC26X_BLOB_MAGIC1 = 'P',
+	TMC26X_BLOB_VERSION = 1,
+	TMC26X_BLOB_HEADER_SIZE = 4,
+	TMC26X_BLOB_CRC_SIZE = 2,
+	TMC26X_BLOB_PAYLOAD_SIZE_V1 = 28,
+	TMC26X_BLOB_MAX_SIZE = TMC26X_BLOB_HEADER_SIZE + 255 + TMC26X_BLOB_CRC_SIZE
+};
+
+// Reads a single byte of blob storage. source is passed through untouched so that
+// the same loader serves a RAM buffer (source = buffer), EEPROM or flash
+// (source unused, address = storage address).
+typedef uint8_t (*TMC26XBlobReader)(const void* source, uint16_t address);
+
+uint16_t tmc26xBlobCRC16(uint16_t crc, uint8_t data);
+uint16_t tmc26xBlobWrite(const TMC26XProfileStepDirSpreadCycle* profile, uint8_t* out);
+int tmc26xBlobRead(TMC26XBlobReader reader, const void* source, uint16_t address, TMC26XProfileStepDirSpreadCycle* profile);
+int tmc26xBlobLoadImage(TMC26XBlobReader reader, const void* source, uint16_t address, uint16_t length);
+uint8_t tmc26xBlobMemoryReader(const void* source, uint16_t address);
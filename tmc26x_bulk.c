@@ -0,0 +1,282 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_bulk.h"
+
+static const int16_t microstepTable[]    = { 256, 128, 64, 32, 16, 8, 4, 2, 1 };
+static const int16_t blankingTable[]     = { 16, 24, 36, 54 };
+static const int16_t hysteresisDecTable[] = { 16, 32, 48, 64 };
+static const int16_t decSpeedTable[]     = { 32, 8, 2, 1 };
+static const int16_t incSizeTable[]      = { 1, 2, 4, 8 };
+static const int16_t slopeHighTable[]    = { TMC26X_MINIMUM, TMC26X_MINIMUM_TEMPERATURE_COMPENSATION,
+                                             TMC26X_MEDIUM_TEMPERATURE_COMPENSATION, TMC26X_MAXIMUM };
+static const int16_t slopeLowTable[]     = { TMC26X_MINIMUM, TMC26X_FIELD_NO_CODE, TMC26X_MEDIUM, TMC26X_MAXIMUM };
+static const int16_t groundShortTable[]  = { TMC26X_ENABLE, TMC26X_DISABLE };
+static const int16_t shortTimerTable[]   = { 32, 16, 12, 8 };
+static const int16_t vsenseTable[]       = { TMC26X_VSENSE_FULL, TMC26X_VSENSE_HALFISH };
+static const int16_t readbackTable[]     = { TMC26X_READBACK_MICROSTEP, TMC26X_READBACK_STALLGUARD, TMC26X_READBACK_COOLSTEP };
+
+#define TABLE(t) .table = t, .tableLength = sizeof(t) / sizeof(int16_t)
+
+// Bit positions as documented on the setters in tmc26x_regs.c
+const TMC26XFieldDescriptor tmc26xFieldDescriptors[TMC26X_FIELD_COUNT] = {
+	[TMC26X_FIELD_DRVCTRL_STEP_INTERPOLATION] =
+	{ .reg = TMC26X_REGISTER_DRVCTRL, .pos = 9, .width = 1, .mode = TMC26X_FIELD_MODE_STEPDIR, .min = 0, .max = 1,
+	  .valid = TMC26X_VALID_BITMASK_DRVCTRL_STEP_INTERPOLATION },
+	[TMC26X_FIELD_DRVCTRL_DOUBLE_EDGE] =
+	{ .reg = TMC26X_REGISTER_DRVCTRL, .pos = 8, .width = 1, .mode = TMC26X_FIELD_MODE_STEPDIR, .min = 0, .max = 1,
+	  .valid = TMC26X_VALID_BITMASK_DRVCTRL_DOUBLE_STEP },
+	[TMC26X_FIELD_DRVCTRL_MICROSTEP_RESOLUTION] =
+	{ .reg = TMC26X_REGISTER_DRVCTRL, .pos = 0, .width = 4, .mode = TMC26X_FIELD_MODE_STEPDIR, TABLE(microstepTable),
+	  .valid = TMC26X_VALID_BITMASK_DRVCTRL_MICROSTEP_RESOLUTION },
+	[TMC26X_FIELD_DRVCTRL_POLARITY_A] =
+	{ .reg = TMC26X_REGISTER_DRVCTRL, .pos = 17, .width = 1, .mode = TMC26X_FIELD_MODE_SPI, .min = 0, .max = 1,
+	  .valid = TMC26X_VALID_BITMASK_DRVCTRL_POLARITY_A },
+	[TMC26X_FIELD_DRVCTRL_POLARITY_B] =
+	{ .reg = TMC26X_REGISTER_DRVCTRL, .pos = 8, .width = 1, .mode = TMC26X_FIELD_MODE_SPI, .min = 0, .max = 1,
+	  .valid = TMC26X_VALID_BITMASK_DRVCTRL_POLARITY_B },
+	[TMC26X_FIELD_DRVCTRL_CURRENT_A] =
+	{ .reg = TMC26X_REGISTER_DRVCTRL, .pos = 9, .width = 8, .mode = TMC26X_FIELD_MODE_SPI, .min = 0, .max = 255,
+	  .valid = TMC26X_VALID_BITMASK_DRVCTRL_CURRENT_A },
+	[TMC26X_FIELD_DRVCTRL_CURRENT_B] =
+	{ .reg = TMC26X_REGISTER_DRVCTRL, .pos = 0, .width = 8, .mode = TMC26X_FIELD_MODE_SPI, .min = 0, .max = 255,
+	  .valid = TMC26X_VALID_BITMASK_DRVCTRL_CURRENT_B },
+	[TMC26X_FIELD_CHOPCONF_CHOPPER_MODE] =
+	{ .reg = TMC26X_REGISTER_CHOPCONF, .pos = 14, .width = 1, .special = 1, .min = 0, .max = 1,
+	  .valid = TMC26X_VALID_BITMASK_CHOPCONF_CHOPMODE },
+	[TMC26X_FIELD_CHOPCONF_BLANKING_TIME] =
+	{ .reg = TMC26X_REGISTER_CHOPCONF, .pos = 15, .width = 2, .special = 1, TABLE(blankingTable),
+	  .valid = TMC26X_VALID_BITMASK_CHOPCONF_BLANKING_TIME },
+	[TMC26X_FIELD_CHOPCONF_RANDOM_TOFF] =
+	{ .reg = TMC26X_REGISTER_CHOPCONF, .pos = 13, .width = 1, .min = 0, .max = 1,
+	  .valid = TMC26X_VALID_BITMASK_CHOPCONF_RANDOM_TOFF },
+	[TMC26X_FIELD_CHOPCONF_TIME_OFF] =
+	{ .reg = TMC26X_REGISTER_CHOPCONF, .pos = 0, .width = 4, .special = 1, .min = 0, .max = 15,
+	  .valid = TMC26X_VALID_BITMASK_CHOPCONF_OFF_TIME },
+	[TMC26X_FIELD_CHOPCONF_HYSTERESIS_DECREMENT] =
+	{ .reg = TMC26X_REGISTER_CHOPCONF, .pos = 11, .width = 2, .mode = TMC26X_FIELD_MODE_SPREADCYCLE, TABLE(hysteresisDecTable),
+	  .valid = TMC26X_VALID_BITMASK_CHOPCONF_HYSTERESIS_DEC },
+	[TMC26X_FIELD_CHOPCONF_HYSTERESIS_START] =
+	{ .reg = TMC26X_REGISTER_CHOPCONF, .pos = 4, .width = 3, .mode = TMC26X_FIELD_MODE_SPREADCYCLE, .special = 1,
+	  .min = 1, .max = 8, .offset = -1, .valid = TMC26X_VALID_BITMASK_CHOPCONF_HYSTERESIS_START },
+	[TMC26X_FIELD_CHOPCONF_HYSTERESIS_END] =
+	{ .reg = TMC26X_REGISTER_CHOPCONF, .pos = 7, .width = 4, .mode = TMC26X_FIELD_MODE_SPREADCYCLE, .special = 1,
+	  .min = -3, .max = 12, .offset = 3, .valid = TMC26X_VALID_BITMASK_CHOPCONF_HYSTERESIS_END },
+	[TMC26X_FIELD_CHOPCONF_FAST_DECAY_MODE] =
+	{ .reg = TMC26X_REGISTER_CHOPCONF, .pos = 12, .width = 1, .mode = TMC26X_FIELD_MODE_FASTDECAY, .min = 0, .max = 1,
+	  .valid = TMC26X_VALID_BITMASK_CHOPCONF_FASTDECAY_MODE },
+	[TMC26X_FIELD_CHOPCONF_SINE_OFFSET] =
+	{ .reg = TMC26X_REGISTER_CHOPCONF, .pos = 7, .width = 4, .mode = TMC26X_FIELD_MODE_FASTDECAY,
+	  .min = -3, .max = 12, .offset = 3, .valid = TMC26X_VALID_BITMASK_CHOPCONF_SINE_OFFSET },
+	[TMC26X_FIELD_CHOPCONF_FAST_DECAY_TIME] =
+	{ .reg = TMC26X_REGISTER_CHOPCONF, .pos = 4, .width = 3, .mode = TMC26X_FIELD_MODE_FASTDECAY, .special = 1,
+	  .min = 0, .max = 15, .valid = TMC26X_VALID_BITMASK_CHOPCONF_FASTDECAY_TIME },
+	[TMC26X_FIELD_SMARTEN_MIN_COOLSTEP_CURRENT] =
+	{ .reg = TMC26X_REGISTER_SMARTEN, .pos = 15, .width = 1, .min = 0, .max = 1,
+	  .valid = TMC26X_VALID_BITMASK_SMARTEN_MIN_COOLSTEP },
+	[TMC26X_FIELD_SMARTEN_CURRENT_DEC_SPEED] =
+	{ .reg = TMC26X_REGISTER_SMARTEN, .pos = 13, .width = 2, TABLE(decSpeedTable),
+	  .valid = TMC26X_VALID_BITMASK_SMARTEN_CURRENT_DEC_SPEED },
+	[TMC26X_FIELD_SMARTEN_HIGH_COOLSTEP_THRESHOLD] =
+	{ .reg = TMC26X_REGISTER_SMARTEN, .pos = 8, .width = 4, .min = 0, .max = 15,
+	  .valid = TMC26X_VALID_BITMASK_SMARTEN_HIGH_COOLSTEP_THRESH },
+	[TMC26X_FIELD_SMARTEN_CURRENT_INC_SIZE] =
+	{ .reg = TMC26X_REGISTER_SMARTEN, .pos = 5, .width = 2, TABLE(incSizeTable),
+	  .valid = TMC26X_VALID_BITMASK_SMARTEN_CURRENT_INC_SIZE },
+	[TMC26X_FIELD_SMARTEN_LOW_COOLSTEP_THRESHOLD] =
+	{ .reg = TMC26X_REGISTER_SMARTEN, .pos = 0, .width = 4, .min = 0, .max = 15,
+	  .valid = TMC26X_VALID_BITMASK_SMARTEN_LOW_COOLSTEP_THRESH },
+	[TMC26X_FIELD_SGCSCONF_STALLGUARD_FILTER] =
+	{ .reg = TMC26X_REGISTER_SGCSCONF, .pos = 16, .width = 1, .min = 0, .max = 1,
+	  .valid = TMC26X_VALID_BITMASK_SGCSCONF_FILTER },
+	[TMC26X_FIELD_SGCSCONF_STALLGUARD_THRESHOLD] =
+	{ .reg = TMC26X_REGISTER_SGCSCONF, .pos = 8, .width = 7, .min = -64, .max = 63,
+	  .valid = TMC26X_VALID_BITMASK_SGCSCONF_THRESHOLD },
+	[TMC26X_FIELD_SGCSCONF_CURRENT_SCALE] =
+	{ .reg = TMC26X_REGISTER_SGCSCONF, .pos = 0, .width = 5, .min = 1, .max = 32, .offset = -1,
+	  .valid = TMC26X_VALID_BITMASK_SGCSCONF_CURRENT_SCALE },
+	[TMC26X_FIELD_DRVCONF_TEST_MODE] =
+	{ .reg = TMC26X_REGISTER_DRVCONF, .pos = 16, .width = 1, .min = 0, .max = 1,
+	  .valid = TMC26X_VALID_BITMASK_DRVCONF_TEST },
+	[TMC26X_FIELD_DRVCONF_SLOPE_CONTROL_HIGH] =
+	{ .reg = TMC26X_REGISTER_DRVCONF, .pos = 14, .width = 2, TABLE(slopeHighTable),
+	  .valid = TMC26X_VALID_BITMASK_DRVCONF_SLOPE_HIGH },
+	[TMC26X_FIELD_DRVCONF_SLOPE_CONTROL_LOW] =
+	{ .reg = TMC26X_REGISTER_DRVCONF, .pos = 12, .width = 2, TABLE(slopeLowTable),
+	  .valid = TMC26X_VALID_BITMASK_DRVCONF_SLOPE_LOW },
+	[TMC26X_FIELD_DRVCONF_GROUND_SHORT_PROTECTION] =
+	{ .reg = TMC26X_REGISTER_DRVCONF, .pos = 10, .width = 1, TABLE(groundShortTable),
+	  .valid = TMC26X_VALID_BITMASK_DRVCONF_GND_SHORT_PROTECT },
+	[TMC26X_FIELD_DRVCONF_GROUND_SHORT_TIMER] =
+	{ .reg = TMC26X_REGISTER_DRVCONF, .pos = 8, .width = 2, TABLE(shortTimerTable),
+	  .valid = TMC26X_VALID_BITMASK_DRVCONF_GND_SHORT_TIMER },
+	[TMC26X_FIELD_DRVCONF_DRIVE_MODE] =
+	{ .reg = TMC26X_REGISTER_DRVCONF, .pos = 7, .width = 1, .special = 1, .min = 0, .max = 1,
+	  .valid = TMC26X_VALID_BITMASK_DRVCONF_DRIVEMODE },
+	[TMC26X_FIELD_DRVCONF_MAXIMUM_RSENSE_VOLTAGE] =
+	{ .reg = TMC26X_REGISTER_DRVCONF, .pos = 6, .width = 1, TABLE(vsenseTable),
+	  .valid = TMC26X_VALID_BITMASK_DRVCONF_VSENSE },
+	[TMC26X_FIELD_DRVCONF_READBACK_VALUE] =
+	{ .reg = TMC26X_REGISTER_DRVCONF, .pos = 4, .width = 2, TABLE(readbackTable),
+	  .valid = TMC26X_VALID_BITMASK_DRVCONF_READBACK }
+};
+
+/* Returns a pointer to the shadow register a descriptor refers to
+**
+** config - Configuration structure
+** reg    - TMC26X_REGISTER_...
+*/
+static uint32_t* tmc26xFieldRegister(TMC26XConfiguration* config, uint8_t reg) {
+	switch (reg) {
+	case TMC26X_REGISTER_DRVCTRL:
+		return &config->regDRVCTRL;
+	case TMC26X_REGISTER_CHOPCONF:
+		return &config->regCHOPCONF;
+	case TMC26X_REGISTER_SMARTEN:
+		return &config->regSMARTEN;
+	case TMC26X_REGISTER_SGCSCONF:
+		return &config->regSGCSCONF;
+	default:
+		return &config->regDRVCONF;
+	}
+}
+
+/* Checks the mode a field requires against the (working) configuration
+**
+** config - Configuration structure
+** mode   - TMC26X_FIELD_MODE_...
+**
+** returns - 1 if the field may be set, otherwise 0
+*/
+static int tmc26xFieldModeOK(TMC26XConfiguration* config, uint8_t mode) {
+	switch (mode) {
+	case TMC26X_FIELD_MODE_STEPDIR:
+		return (config->validity & TMC26X_VALID_BITMASK_DRVCONF_DRIVEMODE)
+		    && !(config->regDRVCONF & TMC26X_DRVCONF_DRIVEMODE_BITMASK);
+	case TMC26X_FIELD_MODE_SPI:
+		return (config->validity & TMC26X_VALID_BITMASK_DRVCONF_DRIVEMODE)
+		    && (config->regDRVCONF & TMC26X_DRVCONF_DRIVEMODE_BITMASK);
+	case TMC26X_FIELD_MODE_SPREADCYCLE:
+		return (config->validity & TMC26X_VALID_BITMASK_CHOPCONF_CHOPMODE)
+		    && !(config->regCHOPCONF & TMC26X_CHOPCONF_CHOPMODE_BITMASK);
+	case TMC26X_FIELD_MODE_FASTDECAY:
+		return (config->validity & TMC26X_VALID_BITMASK_CHOPCONF_CHOPMODE)
+		    && (config->regCHOPCONF & TMC26X_CHOPCONF_CHOPMODE_BITMASK);
+	default:
+		return 1;
+	}
+}
+
+/* Applies a field with side effects or cross-field limits through its setter
+**
+** config - (working) Configuration structure
+** field  - TMC26X_FIELD_...
+** value  - value as passed to the setter
+**
+** returns - the setter's result
+*/
+static int tmc26xFieldApplySpecial(TMC26XConfiguration* config, uint8_t field, int16_t value) {
+	switch (field) {
+	case TMC26X_FIELD_CHOPCONF_CHOPPER_MODE:
+		return tmc26xCHOPCONFSetChopperMode(config, value);
+	case TMC26X_FIELD_CHOPCONF_BLANKING_TIME:
+		return tmc26xCHOPCONFSetBlankingTime(config, value);
+	case TMC26X_FIELD_CHOPCONF_TIME_OFF:
+		return tmc26xCHOPCONFSetTimeOff(config, value);
+	case TMC26X_FIELD_CHOPCONF_HYSTERESIS_START:
+		return tmc26xCHOPCONFSetHysteresisStart(config, value);
+	case TMC26X_FIELD_CHOPCONF_HYSTERESIS_END:
+		return tmc26xCHOPCONFSetHysteresisEnd(config, value);
+	case TMC26X_FIELD_CHOPCONF_FAST_DECAY_TIME:
+		return tmc26xCHOPCONFSetFastDecayTime(config, value);
+	case TMC26X_FIELD_DRVCONF_DRIVE_MODE:
+		return tmc26xDRVCONFSetDriveMode(config, value);
+	default:
+		return TMC26X_INVALID_VALUE;
+	}
+}
+
+/* Applies a list of (field, value) pairs in one go. The pairs are applied in
+** order to a working copy of the configuration (so a mode field listed first
+** governs the fields after it) and the result is only written back if every
+** pair is valid: either all fields change or none do. Each touched register is
+** marked dirty once at the end; nothing is sent to the chip.
+**
+** config - Configuration structure
+** values - (field, value) pairs, values as accepted by the tmc26x_regs.h setters
+** count  - number of pairs
+**
+** returns - TMC26X_SUCCESS, or the first error (TMC26X_INVALID_VALUE for an
+**           unknown field or bad value, TMC26X_INVALID_MODE) with config untouched
+*/
+int tmc26xFieldApply(TMC26XConfiguration* config, const TMC26XFieldValue* values, uint8_t count) {
+	TMC26XConfiguration work = *config;
+	const TMC26XFieldDescriptor* d;
+	uint32_t* reg;
+	uint32_t mask, raw;
+	uint8_t i, code, dirty = 0;
+	int16_t value;
+	int result;
+
+	for (i=0; i<count; i++) {
+		if (values[i].field >= TMC26X_FIELD_COUNT)
+			return TMC26X_INVALID_VALUE;
+
+		d = &tmc26xFieldDescriptors[values[i].field];
+		value = values[i].value;
+
+		if (!tmc26xFieldModeOK(&work, d->mode))
+			return TMC26X_INVALID_MODE;
+
+		//Convert value through lookup or range or indicate invalid value
+		if (d->table) {
+			for (code=0; code<d->tableLength; code++)
+				if (d->table[code] != TMC26X_FIELD_NO_CODE && d->table[code] == value)
+					break;
+			if (code == d->tableLength)
+				return TMC26X_INVALID_VALUE;
+			raw = code;
+		} else {
+			if (value < d->min || value > d->max)
+				return TMC26X_INVALID_VALUE;
+			raw = (uint32_t)(value + d->offset);
+		}
+
+		// Value is in range for the setter's argument type, let it do the rest
+		if (d->special) {
+			if ((result = tmc26xFieldApplySpecial(&work, values[i].field, value)) != TMC26X_SUCCESS)
+				return result;
+			continue;
+		}
+
+		mask = (((uint32_t)1 << d->width) - 1) << d->pos;
+		reg = tmc26xFieldRegister(&work, d->reg);
+		*reg = (*reg & ~mask) | ((raw << d->pos) & mask);
+		work.validity |= d->valid;
+		dirty |= 1 << d->reg;
+	}
+
+	// Register indices follow the TMC26X_DIRTY_BITMASK_ bit order
+	work.dirty |= dirty;
+	*config = work;
+
+	return TMC26X_SUCCESS;
+}
+
+/* Reads the raw bits of a field from the shadow register, shifted to have
+** LSB at 0 (fast decay time returns only its lower three bits).
+**
+** config - Configuration structure
+** field  - TMC26X_FIELD_...
+**
+** returns - raw field bits or TMC26X_INVALID_VALUE for an unknown field
+*/
+int32_t tmc26xFieldGetRaw(TMC26XConfiguration* config, uint8_t field) {
+	const TMC26XFieldDescriptor* d;
+
+	if (field >= TMC26X_FIELD_COUNT)
+		return TMC26X_INVALID_VALUE;
+
+	d = &tmc26xFieldDescriptors[field];
+	return (*tmc26xFieldRegister(config, d->reg) >> d->pos) & (((uint32_t)1 << d->width) - 1);
+}
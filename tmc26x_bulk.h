@@ -0,0 +1,87 @@
+// Field identifiers, one per setter in tmc26x_regs.h
+enum {
+	TMC26X_FIELD_DRVCTRL_STEP_INTERPOLATION = 0,
+	TMC26X_FIELD_DRVCTRL_DOUBLE_EDGE,
+	TMC26X_FIELD_DRVCTRL_MICROSTEP_RESOLUTION,
+	TMC26X_FIELD_DRVCTRL_POLARITY_A,
+	TMC26X_FIELD_DRVCTRL_POLARITY_B,
+	TMC26X_FIELD_DRVCTRL_CURRENT_A,
+	TMC26X_FIELD_DRVCTRL_CURRENT_B,
+	TMC26X_FIELD_CHOPCONF_CHOPPER_MODE,
+	TMC26X_FIELD_CHOPCONF_BLANKING_TIME,
+	TMC26X_FIELD_CHOPCONF_RANDOM_TOFF,
+	TMC26X_FIELD_CHOPCONF_TIME_OFF,
+	TMC26X_FIELD_CHOPCONF_HYSTERESIS_DECREMENT,
+	TMC26X_FIELD_CHOPCONF_HYSTERESIS_START,
+	TMC26X_FIELD_CHOPCONF_HYSTERESIS_END,
+	TMC26X_FIELD_CHOPCONF_FAST_DECAY_MODE,
+	TMC26X_FIELD_CHOPCONF_SINE_OFFSET,
+	TMC26X_FIELD_CHOPCONF_FAST_DECAY_TIME,
+	TMC26X_FIELD_SMARTEN_MIN_COOLSTEP_CURRENT,
+	TMC26X_FIELD_SMARTEN_CURRENT_DEC_SPEED,
+	TMC26X_FIELD_SMARTEN_HIGH_COOLSTEP_THRESHOLD,
+	TMC26X_FIELD_SMARTEN_CURRENT_INC_SIZE,
+	TMC26X_FIELD_SMARTEN_LOW_COOLSTEP_THRESHOLD,
+	TMC26X_FIELD_SGCSCONF_STALLGUARD_FILTER,
+	TMC26X_FIELD_SGCSCONF_STALLGUARD_THRESHOLD,
+	TMC26X_FIELD_SGCSCONF_CURRENT_SCALE,
+	TMC26X_FIELD_DRVCONF_TEST_MODE,
+	TMC26X_FIELD_DRVCONF_SLOPE_CONTROL_HIGH,
+	TMC26X_FIELD_DRVCONF_SLOPE_CONTROL_LOW,
+	TMC26X_FIELD_DRVCONF_GROUND_SHORT_PROTECTION,
+	TMC26X_FIELD_DRVCONF_GROUND_SHORT_TIMER,
+	TMC26X_FIELD_DRVCONF_DRIVE_MODE,
+	TMC26X_FIELD_DRVCONF_MAXIMUM_RSENSE_VOLTAGE,
+	TMC26X_FIELD_DRVCONF_READBACK_VALUE,
+	TMC26X_FIELD_COUNT
+};
+
+// Register index used in the descriptors
+enum {
+	TMC26X_REGISTER_DRVCTRL = 0,
+	TMC26X_REGISTER_CHOPCONF,
+	TMC26X_REGISTER_SMARTEN,
+	TMC26X_REGISTER_SGCSCONF,
+	TMC26X_REGISTER_DRVCONF
+};
+
+// Mode a field requires
+enum {
+	TMC26X_FIELD_MODE_ANY = 0,
+	TMC26X_FIELD_MODE_STEPDIR,
+	TMC26X_FIELD_MODE_SPI,
+	TMC26X_FIELD_MODE_SPREADCYCLE,
+	TMC26X_FIELD_MODE_FASTDECAY
+};
+
+// Marks table codes that have no value (e.g. slope control low, code 1)
+#define TMC26X_FIELD_NO_CODE ((int16_t)-32768)
+
+// Describes where a field lives and how its value is encoded. With a table,
+// the raw code is the index of the value. Otherwise min .. max is accepted
+// and raw = value + offset. Fields with special set true have side effects or
+// cross-field limits and are applied through their tmc26x_regs.h setter.
+typedef struct {
+	uint8_t reg;
+	uint8_t pos;
+	uint8_t width;
+	uint8_t mode;
+	uint8_t special;
+	uint8_t tableLength;
+	const int16_t* table;
+	int16_t min;
+	int16_t max;
+	int16_t offset;
+	uint32_t valid;
+} TMC26XFieldDescriptor;
+
+typedef struct {
+	uint8_t field;
+	int16_t value;
+} TMC26XFieldValue;
+
+
+extern const TMC26XFieldDescriptor tmc26xFieldDescriptors[TMC26X_FIELD_COUNT];
+
+int tmc26xFieldApply(TMC26XConfiguration* config, const TMC26XFieldValue* values, uint8_t count);
+int32_t tmc26xFieldGetRaw(TMC26XConfiguration* config, uint8_t field);
@@ -0,0 +1,203 @@
+#include <stdint.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_decode.h"
+
+/* Empties a statistics structure. Statistics accumulate over any number of
+** tmc26xDecode calls.
+**
+** stats - statistics structure
+*/
+void tmc26xDecodeStatsInit(TMC26XDecodeStats* stats) {
+	uint8_t i;
+
+	stats->count = 0;
+	stats->minValue = 0xFFFF;
+	stats->maxValue = 0;
+	stats->sumValue = 0;
+	stats->minSE = 0xFF;
+	stats->maxSE = 0;
+	stats->sumSE = 0;
+	for (i=0; i<8; i++)
+		stats->flags[i] = 0;
+}
+
+/* Plain C decoder, also used for the tail the vector loop leaves
+**
+** words    - 20-bit responses
+** count    - number of words
+** readback - TMC26X_READBACK_... the words were read with
+** value    - receives count values
+** se       - receives count SE values in coolStep mode, unused otherwise (may be 0)
+** status   - receives count status bytes
+** stats    - statistics to update
+**
+** returns - TMC26X_SUCCESS or TMC26X_INVALID_VALUE for an unknown readback
+*/
+int tmc26xDecodeScalar(const uint32_t* words, uint32_t count, uint8_t readback, uint16_t* value, uint8_t* se, uint8_t* status, TMC26XDecodeStats* stats) {
+	uint32_t i;
+	uint16_t v;
+	uint8_t e, s, b;
+
+	if (readback != TMC26X_READBACK_MICROSTEP && readback != TMC26X_READBACK_STALLGUARD
+	 && readback != TMC26X_READBACK_COOLSTEP)
+		return TMC26X_INVALID_VALUE;
+
+	for (i=0; i<count; i++) {
+		v = (words[i] >> 10) & 0x3FF;
+		s = words[i] & 0xFF;
+		if (readback == TMC26X_READBACK_COOLSTEP) {
+			e = v & 0x1F;
+			v &= 0x3E0;
+			se[i] = e;
+			if (e < stats->minSE)
+				stats->minSE = e;
+			if (e > stats->maxSE)
+				stats->maxSE = e;
+			stats->sumSE += e;
+		}
+		value[i] = v;
+		status[i] = s;
+
+		if (v < stats->minValue)
+			stats->minValue = v;
+		if (v > stats->maxValue)
+			stats->maxValue = v;
+		stats->sumValue += v;
+		for (b=0; b<8; b++)
+			stats->flags[b] += (s >> b) & 1;
+	}
+	stats->count += count;
+
+	return TMC26X_SUCCESS;
+}
+
+#ifdef __SSE2__
+static uint16_t tmc26xDecodeHorizontal(__m128i v, int maximum) {
+	uint16_t lanes[8], result;
+	uint8_t i;
+
+	_mm_storeu_si128((__m128i*)lanes, v);
+	result = lanes[0];
+	for (i=1; i<8; i++)
+		if (maximum ? lanes[i] > result : lanes[i] < result)
+			result = lanes[i];
+	return result;
+}
+
+static uint32_t tmc26xDecodePopcount(uint32_t x) {
+	x = x - ((x >> 1) & 0x55555555);
+	x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+	return (((x + (x >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
+
+/* SSE2 decoder for up to 65536 words, a multiple of 16. The sums are kept in
+** 32-bit lanes, which the length limit keeps from overflowing.
+*/
+static void tmc26xDecodeSSE2(const uint32_t* words, uint32_t count, uint8_t coolStep, uint16_t* value, uint8_t* se, uint8_t* status, TMC26XDecodeStats* stats) {
+	const __m128i valueMask = _mm_set1_epi32(0x3FF), statusMask = _mm_set1_epi32(0xFF);
+	const __m128i seMask = _mm_set1_epi16(0x1F), sgMask = _mm_set1_epi16(0x3E0);
+	const __m128i ones = _mm_set1_epi16(1);
+	__m128i minValue = _mm_set1_epi16(0x7FFF), maxValue = _mm_setzero_si128();
+	__m128i minSE = _mm_set1_epi16(0x7FFF), maxSE = _mm_setzero_si128();
+	__m128i sumValue = _mm_setzero_si128(), sumSE = _mm_setzero_si128();
+	__m128i w0, w1, w2, w3, v0, v1, s0, s1, e0, e1, s;
+	uint32_t sums[4], flags[8] = {0}, i;
+	uint16_t m;
+	uint8_t b;
+
+	for (i=0; i<count; i+=16) {
+		w0 = _mm_loadu_si128((const __m128i*)&words[i]);
+		w1 = _mm_loadu_si128((const __m128i*)&words[i+4]);
+		w2 = _mm_loadu_si128((const __m128i*)&words[i+8]);
+		w3 = _mm_loadu_si128((const __m128i*)&words[i+12]);
+
+		// Values fit 10 bits, so the signed saturating packs are exact
+		v0 = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(w0, 10), valueMask),
+			_mm_and_si128(_mm_srli_epi32(w1, 10), valueMask));
+		v1 = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(w2, 10), valueMask),
+			_mm_and_si128(_mm_srli_epi32(w3, 10), valueMask));
+		s0 = _mm_packs_epi32(_mm_and_si128(w0, statusMask), _mm_and_si128(w1, statusMask));
+		s1 = _mm_packs_epi32(_mm_and_si128(w2, statusMask), _mm_and_si128(w3, statusMask));
+		s = _mm_packus_epi16(s0, s1);
+
+		if (coolStep) {
+			e0 = _mm_and_si128(v0, seMask);
+			e1 = _mm_and_si128(v1, seMask);
+			v0 = _mm_and_si128(v0, sgMask);
+			v1 = _mm_and_si128(v1, sgMask);
+			_mm_storeu_si128((__m128i*)&se[i], _mm_packus_epi16(e0, e1));
+			minSE = _mm_min_epi16(minSE, _mm_min_epi16(e0, e1));
+			maxSE = _mm_max_epi16(maxSE, _mm_max_epi16(e0, e1));
+			sumSE = _mm_add_epi32(sumSE, _mm_madd_epi16(_mm_add_epi16(e0, e1), ones));
+		}
+
+		_mm_storeu_si128((__m128i*)&value[i], v0);
+		_mm_storeu_si128((__m128i*)&value[i+8], v1);
+		_mm_storeu_si128((__m128i*)&status[i], s);
+
+		minValue = _mm_min_epi16(minValue, _mm_min_epi16(v0, v1));
+		maxValue = _mm_max_epi16(maxValue, _mm_max_epi16(v0, v1));
+		sumValue = _mm_add_epi32(sumValue, _mm_madd_epi16(_mm_add_epi16(v0, v1), ones));
+
+		// Move each status bit to the top of its byte and count the set bytes
+		for (b=0; b<8; b++) {
+			m = _mm_movemask_epi8(_mm_slli_epi16(s, 7 - b));
+			flags[b] += tmc26xDecodePopcount(m);
+		}
+	}
+
+	m = tmc26xDecodeHorizontal(minValue, 0);
+	if (m < stats->minValue)
+		stats->minValue = m;
+	m = tmc26xDecodeHorizontal(maxValue, 1);
+	if (m > stats->maxValue)
+		stats->maxValue = m;
+	_mm_storeu_si128((__m128i*)sums, sumValue);
+	stats->sumValue += (uint64_t)sums[0] + sums[1] + sums[2] + sums[3];
+	if (coolStep) {
+		m = tmc26xDecodeHorizontal(minSE, 0);
+		if (m < stats->minSE)
+			stats->minSE = m;
+		m = tmc26xDecodeHorizontal(maxSE, 1);
+		if (m > stats->maxSE)
+			stats->maxSE = m;
+		_mm_storeu_si128((__m128i*)sums, sumSE);
+		stats->sumSE += (uint64_t)sums[0] + sums[1] + sums[2] + sums[3];
+	}
+	for (b=0; b<8; b++)
+		stats->flags[b] += flags[b];
+	stats->count += count;
+}
+#endif
+
+/* Decodes a block of responses, 16 words per step with SSE2 where the
+** compiler targets it, otherwise (and for the last count % 16 words) with
+** tmc26xDecodeScalar. Results are identical either way.
+**
+** see tmc26xDecodeScalar
+*/
+int tmc26xDecode(const uint32_t* words, uint32_t count, uint8_t readback, uint16_t* value, uint8_t* se, uint8_t* status, TMC26XDecodeStats* stats) {
+#ifdef __SSE2__
+	uint8_t coolStep = readback == TMC26X_READBACK_COOLSTEP;
+	uint32_t done = 0, n;
+
+	if (readback != TMC26X_READBACK_MICROSTEP && readback != TMC26X_READBACK_STALLGUARD && !coolStep)
+		return TMC26X_INVALID_VALUE;
+
+	while (count - done >= 16) {
+		n = (count - done) & ~15u;
+		if (n > 65536)
+			n = 65536;
+		tmc26xDecodeSSE2(&words[done], n, coolStep, &value[done], coolStep ? &se[done] : se, &status[done], stats);
+		done += n;
+	}
+
+	return tmc26xDecodeScalar(&words[done], count - done, readback, &value[done], coolStep ? &se[done] : se, &status[done], stats);
+#else
+	return tmc26xDecodeScalar(words, count, readback, value, se, status, stats);
+#endif
+}
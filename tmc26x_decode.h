@@ -0,0 +1,25 @@
+// Host decoder for logged readback responses (tmc26xReadRaw), splitting
+// them into columns. The layout of bits 10-19 depends on the RDSEL the
+// words were read with:
+//   TMC26X_READBACK_MICROSTEP  - MSTEP, bit 19 is the coil A polarity
+//   TMC26X_READBACK_STALLGUARD - SG, 10 bits
+//   TMC26X_READBACK_COOLSTEP   - SG bits 9-5 in 19-15, SE in 14-10
+// and bits 0-7 are always the status flags (TMC26X_STATUS_... in
+// tmc26x_emu.h). In coolStep mode the value column holds the 5 SG bits in
+// their place (low 5 bits zero), so it compares with the other SG readings.
+
+typedef struct {
+	uint32_t count;
+	uint16_t minValue;
+	uint16_t maxValue;
+	uint64_t sumValue;
+	uint8_t minSE;
+	uint8_t maxSE;
+	uint64_t sumSE;
+	uint32_t flags[8];     // words with status bit n set
+} TMC26XDecodeStats;
+
+
+void tmc26xDecodeStatsInit(TMC26XDecodeStats* stats);
+int tmc26xDecode(const uint32_t* words, uint32_t count, uint8_t readback, uint16_t* value, uint8_t* se, uint8_t* status, TMC26XDecodeStats* stats);
+int tmc26xDecodeScalar(const uint32_t* words, uint32_t count, uint8_t readback, uint16_t* value, uint8_t* se, uint8_t* status, TMC26XDecodeStats* stats);
@@ -0,0 +1,117 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_emu.h"
+
+/* Puts the emulator in the power-on state: all registers zero, which leaves
+** the bridges off (TOFF = 0), standing still at the start of the sine table.
+**
+** emu - emulator structure
+*/
+void tmc26xEmuInit(TMC26XEmulator* emu) {
+	emu->DRVCTRL = 0;
+	emu->CHOPCONF = 0;
+	emu->SMARTEN = 0;
+	emu->SGCSCONF = 0;
+	emu->DRVCONF = 0;
+	emu->mstep = 0;
+	emu->sg = 0;
+	emu->se = 0;
+	emu->status = TMC26X_STATUS_STST;
+	emu->frames = 0;
+}
+
+/* Returns the current scale the chip is running at: CS from SGCSCONF while
+** coolStep is off (SEMIN = 0), otherwise se limited to SEIMIN .. CS.
+**
+** emu - emulator structure
+**
+** returns - 0 .. 31
+*/
+uint8_t tmc26xEmuCurrentScale(TMC26XEmulator* emu) {
+	uint8_t cs = emu->SGCSCONF & 0x1F;
+	uint8_t minimum;
+
+	if (!(emu->SMARTEN & 0x0F))
+		return cs;
+
+	// SEIMIN (bit 15) selects 1/2 or 1/4 of CS as the lower limit
+	minimum = (emu->SMARTEN & 0x8000) ? (cs + 1) / 4 : (cs + 1) / 2;
+	if (emu->se > cs)
+		return cs;
+	if (emu->se < minimum)
+		return minimum;
+	return emu->se;
+}
+
+/* Clocks one frame through the emulator. The response is the one the chip
+** shifts out while receiving the command, so it uses the RDSEL in effect
+** before the command is latched (data-sheet section 6.5).
+**
+** emu     - emulator structure
+** command - 20-bit datagram
+**
+** returns - the 20-bit response
+*/
+uint32_t tmc26xEmuTransfer(TMC26XEmulator* emu, uint32_t command) {
+	uint32_t response;
+
+	switch ((emu->DRVCONF >> 4) & 0x03) {
+	case 0:
+		response = (uint32_t)(emu->mstep & 0x3FF) << 10;
+		break;
+	case 1:
+		response = (uint32_t)(emu->sg & 0x3FF) << 10;
+		break;
+	default:
+		response = (uint32_t)(emu->sg & 0x3E0) << 10;
+		response |= (uint32_t)tmc26xEmuCurrentScale(emu) << 10;
+		break;
+	}
+	response |= emu->status;
+
+	command &= 0xFFFFF;
+	if (!(command & 0x80000))
+		emu->DRVCTRL = command;
+	else switch (command & 0xE0000) {
+	case TMC26X_CHOPCONF_ADDRESS:
+		emu->CHOPCONF = command;
+		break;
+	case TMC26X_SMARTEN_ADDRESS:
+		emu->SMARTEN = command;
+		break;
+	case TMC26X_SGCSCONF_ADDRESS:
+		emu->SGCSCONF = command;
+		break;
+	case TMC26X_DRVCONF_ADDRESS:
+		emu->DRVCONF = command;
+		break;
+	}
+	emu->frames++;
+
+	return response;
+}
+
+/* Applies one STEP pulse in step/dir mode: the table position advances by
+** 2^MRES (one full step is 256 positions at MRES = 8). Ignored while the
+** bridges are off or in SPI mode.
+**
+** emu       - emulator structure
+** direction - 1 or -1
+*/
+void tmc26xEmuStep(TMC26XEmulator* emu, int8_t direction) {
+	uint16_t increment;
+
+	if ((emu->DRVCONF & TMC26X_DRVCONF_DRIVEMODE_BITMASK) || !(emu->CHOPCONF & 0x0F))
+		return;
+
+	increment = emu->DRVCTRL & 0x0F;
+	if (increment > 8)
+		increment = 8;
+	increment = 1 << increment;
+	if (direction < 0)
+		emu->mstep = (emu->mstep - increment) & 0x3FF;
+	else
+		emu->mstep = (emu->mstep + increment) & 0x3FF;
+	emu->status &= ~TMC26X_STATUS_STST;
+}
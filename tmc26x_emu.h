@@ -0,0 +1,35 @@
+// Register level model of a TMC26X for host builds: latches the five
+// registers written to it and answers each frame with the response selected
+// by RDSEL, built from the microstep, stallGuard and coolStep values held in
+// the structure. Nothing here models the motor, whoever drives the emulator
+// (test, trace replay, plant model) sets mstep, sg and se.
+typedef struct {
+	uint32_t DRVCTRL;
+	uint32_t CHOPCONF;
+	uint32_t SMARTEN;
+	uint32_t SGCSCONF;
+	uint32_t DRVCONF;
+	uint16_t mstep;   // microstep table position, 0 .. 1023
+	uint16_t sg;      // stallGuard2 result, 0 .. 1023
+	uint8_t se;       // actual current scale, 0 .. 31
+	uint8_t status;   // response bits 0-7 (TMC26X_STATUS_...)
+	uint16_t frames;
+} TMC26XEmulator;
+
+// Response status flags (bits 0-7)
+enum {
+	TMC26X_STATUS_SG   = 1 << 0,
+	TMC26X_STATUS_OT   = 1 << 1,
+	TMC26X_STATUS_OTPW = 1 << 2,
+	TMC26X_STATUS_S2GA = 1 << 3,
+	TMC26X_STATUS_S2GB = 1 << 4,
+	TMC26X_STATUS_OLA  = 1 << 5,
+	TMC26X_STATUS_OLB  = 1 << 6,
+	TMC26X_STATUS_STST = 1 << 7
+};
+
+
+void tmc26xEmuInit(TMC26XEmulator* emu);
+uint32_t tmc26xEmuTransfer(TMC26XEmulator* emu, uint32_t command);
+void tmc26xEmuStep(TMC26XEmulator* emu, int8_t direction);
+uint8_t tmc26xEmuCurrentScale(TMC26XEmulator* emu);
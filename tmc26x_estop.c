@@ -0,0 +1,120 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_estop.h"
+#include "tmc26x_arch.h"
+
+// Axes stopped and released by tmc26xEmergencyStop/tmc26xEmergencyRelease
+static TMC26XConfiguration* stopAxes[TMC26X_MAX_AXES];
+static uint8_t stopAxisCount = 0;
+
+// Axis whose frame the last stop interrupted, TMC26X_NO_AXIS if none
+static uint8_t stopInterrupted = TMC26X_NO_AXIS;
+
+/* Clocks one pre-serialized frame out to an axis. The chip select may already
+** be asserted (frame interrupted by the stop), in which case the TMC26X
+** simply latches the last 20 bits shifted in, i.e. this frame. The frame is
+** also passed to tmc26xFrameHook, with interrupts still disabled.
+**
+** config - Configuration structure of the axis
+** frame  - three big-endian bytes
+*/
+static void tmc26xSendFrame(TMC26XConfiguration* config, const uint8_t* frame) {
+	uint32_t command = ((uint32_t)frame[0] << 16 | (uint32_t)frame[1] << 8 | frame[2]) & 0xFFFFF;
+	uint32_t response;
+
+#ifndef UNIT_TESTING
+	tmc26xSPIAxisChipEnable(config->axis);
+	response = tmc26xSPITransceiveFrameBlocking(config->axis, frame[0], frame[1], frame[2]) >> 4;
+	tmc26xSPIAxisChipDisable(config->axis);
+#else
+	response = tmc26xHostTransport(config, command);
+#endif
+	if (tmc26xFrameHook)
+		tmc26xFrameHook(config, command, response);
+}
+
+/* Adds an axis to the set switched off by tmc26xEmergencyStop. The stop and
+** release frames are taken from the committed CHOPCONF, so the axis should
+** have been committed at least once (e.g. by initializeTMC26XWithProfile).
+**
+** config - Configuration structure of the axis
+**
+** returns - TMC26X_SUCCESS, TMC26X_INVALID_CONFIG if CHOPCONF has never been
+**           committed or TMC26X_INVALID_VALUE if TMC26X_MAX_AXES are registered
+*/
+int tmc26xEmergencyStopRegister(TMC26XConfiguration* config) {
+	if ((config->runFrame[0] & 0x0E) != (TMC26X_CHOPCONF_ADDRESS >> 16))
+		return TMC26X_INVALID_CONFIG;
+
+	if (stopAxisCount == TMC26X_MAX_AXES)
+		return TMC26X_INVALID_VALUE;
+
+	stopAxes[stopAxisCount++] = config;
+
+	return TMC26X_SUCCESS;
+}
+
+/* Switches off the bridges of every registered axis by writing CHOPCONF with
+** TOFF = 0. Callable from any interrupt level: it runs with interrupts
+** disabled, takes the bus from the normal path and latches
+** tmc26xEmergencyStopped, which blocks all other traffic (and so any commit
+** that would re-enable a bridge) until tmc26xEmergencyRelease.
+**
+** Worst case bus time with N registered axes is 8 + 24 * N SPI clocks at the
+** clock currently set (TMC26X_SPI_PRESCALER or the USART baud rate): at most
+** one byte of an interrupted frame is finished (two, i.e. 16 clocks, on the
+** USART transport), then one 24-clock frame per axis. An interrupted
+** frame is completed with that axis' stop frame first, while its chip select
+** is still asserted. The chip select of the interrupted axis is released
+** afterwards even if the axis is not registered.
+*/
+void tmc26xEmergencyStop(void) {
+	uint8_t i, active;
+	tmc26xCriticalBegin();
+
+	active = tmc26xActiveAxis;
+	tmc26xEmergencyStopped = 1;
+	stopInterrupted = active;
+
+	if (active != TMC26X_NO_AXIS) {
+		tmc26xSPIDrain(active);
+		for (i=0; i<stopAxisCount; i++)
+			if (stopAxes[i]->axis == active)
+				tmc26xSendFrame(stopAxes[i], stopAxes[i]->stopFrame);
+		tmc26xSPIAxisChipDisable(active);
+	}
+
+	for (i=0; i<stopAxisCount; i++)
+		if (stopAxes[i]->axis != active)
+			tmc26xSendFrame(stopAxes[i], stopAxes[i]->stopFrame);
+
+	tmc26xCriticalEnd();
+}
+
+/* Restores the committed CHOPCONF on every registered axis (24 SPI clocks per
+** axis) and lets normal traffic resume. Commits interrupted by the stop kept
+** their dirty bits, so the next tmc26xCommitConfiguration completes them.
+**
+** A transfer interrupted between its check of tmc26xEmergencyStopped and its
+** write to DATA still writes that byte once the stop returns. The byte may be
+** shifting yet or have left its flags and received bytes behind, so the buses
+** are drained first and the run frames go out whole.
+*/
+void tmc26xEmergencyRelease(void) {
+	uint8_t i;
+	tmc26xCriticalBegin();
+
+	if (stopInterrupted != TMC26X_NO_AXIS)
+		tmc26xSPIDrain(stopInterrupted);
+	for (i=0; i<stopAxisCount; i++)
+		tmc26xSPIDrain(stopAxes[i]->axis);
+	stopInterrupted = TMC26X_NO_AXIS;
+
+	for (i=0; i<stopAxisCount; i++)
+		tmc26xSendFrame(stopAxes[i], stopAxes[i]->runFrame);
+
+	tmc26xEmergencyStopped = 0;
+
+	tmc26xCriticalEnd();
+}
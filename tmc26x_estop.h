@@ -0,0 +1,7 @@
+#ifndef TMC26X_MAX_AXES
+#define TMC26X_MAX_AXES 4
+#endif
+
+int tmc26xEmergencyStopRegister(TMC26XConfiguration* config);
+void tmc26xEmergencyStop(void);
+void tmc26xEmergencyRelease(void);
@@ -0,0 +1,127 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_fast.h"
+#include "tmc26x_arch.h"
+
+/* Splits a 20-bit register into its three big-endian wire bytes
+**
+** reg   - register value
+** bytes - destination
+*/
+static void tmc26xFastSerialize(uint32_t reg, uint8_t* bytes) {
+	bytes[0] = (uint8_t)(reg >> 16);
+	bytes[1] = (uint8_t)(reg >> 8);
+	bytes[2] = (uint8_t)reg;
+}
+
+/* Joins three big-endian wire bytes back into a register value
+**
+** bytes - source
+**
+** returns - register value
+*/
+static uint32_t tmc26xFastDeserialize(const uint8_t* bytes) {
+	return ((uint32_t)bytes[0] << 16) | ((uint32_t)bytes[1] << 8) | bytes[2];
+}
+
+/* Copies the shadow registers of a configuration into their serialized form.
+** The configuration's dirty bits are handed over as well; until
+** tmc26xFastStore the serialized copy owns the registers.
+**
+** fast   - serialized registers
+** config - Configuration structure
+*/
+void tmc26xFastLoad(TMC26XFastRegisters* fast, TMC26XConfiguration* config) {
+	tmc26xFastSerialize(config->regDRVCTRL, fast->DRVCTRL);
+	tmc26xFastSerialize(config->regCHOPCONF, fast->CHOPCONF);
+	tmc26xFastSerialize(config->regSMARTEN, fast->SMARTEN);
+	tmc26xFastSerialize(config->regSGCSCONF, fast->SGCSCONF);
+	tmc26xFastSerialize(config->regDRVCONF, fast->DRVCONF);
+	fast->dirty = config->dirty;
+	config->dirty = 0;
+}
+
+/* Copies serialized registers back into the configuration shadow, so that the
+** normal API (commits, readback helpers, scrubber) sees the fast path's
+** changes. Dirty bits are merged.
+**
+** fast   - serialized registers
+** config - Configuration structure
+*/
+void tmc26xFastStore(TMC26XFastRegisters* fast, TMC26XConfiguration* config) {
+	TMC26XFastRegisters copy;
+	tmc26xCriticalBegin();
+	copy = *fast;
+	tmc26xCriticalEnd();
+
+	config->regDRVCTRL = tmc26xFastDeserialize(copy.DRVCTRL);
+	config->regCHOPCONF = tmc26xFastDeserialize(copy.CHOPCONF);
+	config->regSMARTEN = tmc26xFastDeserialize(copy.SMARTEN);
+	config->regSGCSCONF = tmc26xFastDeserialize(copy.SGCSCONF);
+	config->regDRVCONF = tmc26xFastDeserialize(copy.DRVCONF);
+	config->dirty |= copy.dirty;
+}
+
+/* Gives the dirty bits of an interrupted commit back, so the next commit
+** sends those registers again (with whatever values they have by then)
+**
+** fast  - serialized registers
+** dirty - dirty bits taken by the commit
+*/
+static void tmc26xFastRestoreDirty(TMC26XFastRegisters* fast, uint8_t dirty) {
+	tmc26xCriticalBegin();
+	fast->dirty |= dirty;
+	tmc26xCriticalEnd();
+}
+
+/* Sends the dirty serialized registers straight from their wire bytes, in the
+** same order as tmc26xCommitConfiguration (DRVCONF before SGCSCONF). Current
+** changes that cross the VSENSE boundary must go through
+** tmc26xSetFullScaleCurrent instead.
+**
+** The registers and dirty bits are taken, and the dirty bits cleared, with
+** interrupts disabled; the frames are sent from that copy. A setter run from
+** an ISR during the commit marks its register dirty again for the next one
+** and cannot tear a frame being sent.
+**
+** fast   - serialized registers
+** config - Configuration structure (needed only for the axis)
+**
+** returns - TMC26X_SUCCESS or TMC26X_EMERGENCY_STOP if a stop is latched
+*/
+int tmc26xFastCommit(TMC26XFastRegisters* fast, TMC26XConfiguration* config) {
+	TMC26XFastRegisters sent;
+
+	if (tmc26xEmergencyStopped)
+		return TMC26X_EMERGENCY_STOP;
+
+	tmc26xCriticalBegin();
+	sent = *fast;
+	fast->dirty = 0;
+	tmc26xCriticalEnd();
+
+	if (sent.dirty & TMC26X_DIRTY_BITMASK_DRVCONF)
+		tmc26xSendSerialized(config, sent.DRVCONF);
+
+	if (sent.dirty & TMC26X_DIRTY_BITMASK_SGCSCONF)
+		tmc26xSendSerialized(config, sent.SGCSCONF);
+
+	if (sent.dirty & TMC26X_DIRTY_BITMASK_DRVCTRL)
+		tmc26xSendSerialized(config, sent.DRVCTRL);
+
+	if (sent.dirty & TMC26X_DIRTY_BITMASK_CHOPCONF) {
+		tmc26xSendSerialized(config, sent.CHOPCONF);
+		tmc26xSerializeStopFrames(config, tmc26xFastDeserialize(sent.CHOPCONF));
+	}
+
+	if (sent.dirty & TMC26X_DIRTY_BITMASK_SMARTEN)
+		tmc26xSendSerialized(config, sent.SMARTEN);
+
+	// A stop fired during the commit, keep the registers dirty for a replay
+	if (tmc26xEmergencyStopped) {
+		tmc26xFastRestoreDirty(fast, sent.dirty);
+		return TMC26X_EMERGENCY_STOP;
+	}
+
+	return TMC26X_SUCCESS;
+}
@@ -0,0 +1,47 @@
+// Shadow registers kept as the three big-endian bytes sent on the wire, for
+// use from a step ISR. The setters below take raw field values (already
+// encoded and range checked by the caller), touch only the bytes holding the
+// field and never branch. tmc26xFastLoad/tmc26xFastStore move the registers
+// between this structure and the TMC26XConfiguration shadow. Commit and store
+// take the registers and dirty bits with interrupts disabled, so the setters
+// may run from an ISR meanwhile.
+typedef struct {
+	uint8_t DRVCTRL[3];
+	uint8_t CHOPCONF[3];
+	uint8_t SMARTEN[3];
+	uint8_t SGCSCONF[3];
+	uint8_t DRVCONF[3];
+	volatile uint8_t dirty;
+} TMC26XFastRegisters;
+
+
+void tmc26xFastLoad(TMC26XFastRegisters* fast, TMC26XConfiguration* config);
+void tmc26xFastStore(TMC26XFastRegisters* fast, TMC26XConfiguration* config);
+int tmc26xFastCommit(TMC26XFastRegisters* fast, TMC26XConfiguration* config);
+
+// SGCSCONF bits 0-4, cs is the raw CS field (current scale - 1, 0 .. 31)
+static inline void tmc26xFastSetCurrentScale(TMC26XFastRegisters* fast, uint8_t cs) {
+	fast->SGCSCONF[2] = (fast->SGCSCONF[2] & 0xE0) | (cs & 0x1F);
+	fast->dirty |= TMC26X_DIRTY_BITMASK_SGCSCONF;
+}
+
+// SGCSCONF bits 8-14, sgt is the signed threshold (-64 .. 63)
+static inline void tmc26xFastSetStallGuardThreshold(TMC26XFastRegisters* fast, int8_t sgt) {
+	fast->SGCSCONF[1] = (fast->SGCSCONF[1] & 0x80) | ((uint8_t)sgt & 0x7F);
+	fast->dirty |= TMC26X_DIRTY_BITMASK_SGCSCONF;
+}
+
+// DRVCTRL bits 0-3 (step/dir mode), mres is the raw MRES field (0 = 256 .. 8 = 1)
+static inline void tmc26xFastSetMicrostepResolution(TMC26XFastRegisters* fast, uint8_t mres) {
+	fast->DRVCTRL[2] = (fast->DRVCTRL[2] & 0xF0) | (mres & 0x0F);
+	fast->dirty |= TMC26X_DIRTY_BITMASK_DRVCTRL;
+}
+
+// DRVCTRL in SPI mode: PHA bit 17, CA bits 9-16, PHB bit 8, CB bits 0-7.
+// All four fields share the register so they are always written together.
+static inline void tmc26xFastSetCoilCurrents(TMC26XFastRegisters* fast, uint8_t pha, uint8_t ca, uint8_t phb, uint8_t cb) {
+	fast->DRVCTRL[0] = ((pha & 1) << 1) | (ca >> 7);
+	fast->DRVCTRL[1] = (uint8_t)(ca << 1) | (phb & 1);
+	fast->DRVCTRL[2] = cb;
+	fast->dirty |= TMC26X_DIRTY_BITMASK_DRVCTRL;
+}
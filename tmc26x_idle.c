@@ -0,0 +1,115 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_bulk.h"
+#include "tmc26x_steptrack.h"
+#include "tmc26x_idle.h"
+
+/* Sets up the idle manager of one axis, starting active
+**
+** idle    - idle manager structure
+** config  - Configuration structure of the axis, CHOPCONF committed
+** timeout - tmc26xIdleTick calls without a wake before powering down
+** park    - moves the axis to a full step first, or 0. Only for step/dir
+**
+** returns - TMC26X_SUCCESS, TMC26X_INVALID_MODE for parking in SPI mode,
+**           or TMC26X_INVALID_CONFIG
+*/
+int tmc26xIdleInit(TMC26XIdle* idle, TMC26XConfiguration* config, uint16_t timeout, TMC26XIdlePark park) {
+	if (config->validity != 0xFFFFFFFF)
+		return TMC26X_INVALID_CONFIG;
+	if (park && (config->regDRVCONF & TMC26X_DRVCONF_DRIVEMODE_BITMASK))
+		return TMC26X_INVALID_MODE;
+
+	idle->config = config;
+	idle->park = park;
+	idle->timeout = timeout;
+	idle->count = 0;
+	idle->state = TMC26X_IDLE_ACTIVE;
+
+	return TMC26X_SUCCESS;
+}
+
+/* Moves the axis to the nearest full step, the sine table positions
+** 128 + 256 * n where both coils carry the same current (see
+** tmc26x_steptrack.h).
+**
+** idle - idle manager structure
+*/
+static void tmc26xIdleParkStep(TMC26XIdle* idle) {
+	uint8_t mres = tmc26xFieldGetRaw(idle->config, TMC26X_FIELD_DRVCTRL_MICROSTEP_RESOLUTION);
+	int16_t offset;
+
+	offset = (int16_t)(tmc26xReadMicroStepValue(idle->config) & 0xFF) - TMC26X_FULL_STEP_PHASE;
+	if (mres > 8)
+		mres = 8;
+
+	// Round to whole STEP pulses, a coarse MRES may not reach the exact entry
+	offset = (offset >= 0 ? offset + (1 << mres) / 2 : offset - (1 << mres) / 2) / (1 << mres);
+	if (offset)
+		idle->park(idle->config, -offset);
+}
+
+/* Counts an idle tick, to be called periodically while the axis gets no
+** STEP pulses or motion commands. Parking takes one tick, the power down
+** frame goes out on the next. Setting TOFF while powered down and committing
+** it turns the bridges back on, tmc26xIdleWake should be used instead.
+**
+** idle - idle manager structure
+**
+** returns - TMC26X_IDLE_ACTIVE, TMC26X_IDLE_PARKING or TMC26X_IDLE_OFF
+*/
+int tmc26xIdleTick(TMC26XIdle* idle) {
+	TMC26XConfiguration* config = idle->config;
+
+	if (idle->state == TMC26X_IDLE_OFF)
+		return TMC26X_IDLE_OFF;
+
+	if (idle->state == TMC26X_IDLE_ACTIVE) {
+		if (++idle->count < idle->timeout)
+			return TMC26X_IDLE_ACTIVE;
+		if (idle->park) {
+			tmc26xIdleParkStep(idle);
+			idle->state = TMC26X_IDLE_PARKING;
+			return TMC26X_IDLE_PARKING;
+		}
+	}
+
+	idle->offTime = config->regCHOPCONF & 0x0F;
+	config->regCHOPCONF &= ~(uint32_t)0x0F;
+	tmc26xSendCommand(config, config->regCHOPCONF);
+	tmc26xSerializeStopFrames(config, config->regCHOPCONF);
+	config->dirty &= ~TMC26X_DIRTY_BITMASK_CHOPCONF;
+	idle->state = TMC26X_IDLE_OFF;
+
+	return TMC26X_IDLE_OFF;
+}
+
+/* Restarts the idle timeout, to be called before every move. A powered down
+** axis gets its current and its CHOPCONF back first, with no calculation, so
+** it can be called right before the first STEP pulse. SGCSCONF is taken from
+** the shadow as it is now; it is left to the next commit if DRVCONF is dirty
+** too, as sending it alone could break the safe order.
+**
+** idle - idle manager structure
+*/
+void tmc26xIdleWake(TMC26XIdle* idle) {
+	TMC26XConfiguration* config = idle->config;
+
+	idle->count = 0;
+	if (idle->state == TMC26X_IDLE_OFF) {
+		if (!(config->dirty & TMC26X_DIRTY_BITMASK_DRVCONF)) {
+			tmc26xSendCommand(config, config->regSGCSCONF);
+			if (!tmc26xEmergencyStopped)
+				config->dirty &= ~TMC26X_DIRTY_BITMASK_SGCSCONF;
+		}
+
+		// Unless TOFF was set again while powered down
+		if (!(config->regCHOPCONF & 0x0F))
+			config->regCHOPCONF |= idle->offTime;
+		tmc26xSendCommand(config, config->regCHOPCONF);
+		tmc26xSerializeStopFrames(config, config->regCHOPCONF);
+		config->dirty &= ~TMC26X_DIRTY_BITMASK_CHOPCONF;
+	}
+	idle->state = TMC26X_IDLE_ACTIVE;
+}
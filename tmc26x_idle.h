@@ -0,0 +1,31 @@
+// Called to park a step/dir axis: issue the given number of STEP pulses
+// (negative for the reverse direction) and account for them in the planner's
+// position.
+typedef void (*TMC26XIdlePark)(TMC26XConfiguration* config, int16_t steps);
+
+enum {
+	TMC26X_IDLE_ACTIVE = 0,
+	TMC26X_IDLE_PARKING,
+	TMC26X_IDLE_OFF
+};
+
+// Turns the bridges of an axis off (CHOPCONF TOFF = 0) after it has been idle
+// for a number of ticks. With a park callback the axis is first moved to the
+// nearest full step position, where the rotor sits in a detent and does not
+// move when the current goes away or comes back. TOFF = 0 is kept in the
+// shadow CHOPCONF and the stop/run frames while powered down, so commits,
+// scrubbing and tmc26xEmergencyRelease leave the bridges off. Waking restores
+// TOFF and sends the current shadow SGCSCONF and CHOPCONF, two frames.
+typedef struct {
+	TMC26XConfiguration* config;
+	TMC26XIdlePark park;
+	uint16_t timeout;        // idle ticks before powering down
+	uint16_t count;
+	uint8_t state;
+	uint8_t offTime;         // TOFF at power down, restored on wake
+} TMC26XIdle;
+
+
+int tmc26xIdleInit(TMC26XIdle* idle, TMC26XConfiguration* config, uint16_t timeout, TMC26XIdlePark park);
+int tmc26xIdleTick(TMC26XIdle* idle);
+void tmc26xIdleWake(TMC26XIdle* idle);
@@ -0,0 +1,126 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_load.h"
+
+/* Prepares an empty calibration table
+**
+** table     - table structure
+** profileID - motor profile the table belongs to
+** speedStep - spacing of the calibration speeds, full steps/s
+** cs        - current scale (SGCSCONF CS field) the calibration runs at
+*/
+void tmc26xLoadTableInit(TMC26XLoadTable* table, int profileID, uint16_t speedStep, uint8_t cs) {
+	uint8_t i;
+
+	table->profileID = profileID;
+	table->speedStep = speedStep;
+	table->cs = cs;
+	for (i=0; i<TMC26X_LOAD_POINTS; i++) {
+		table->sgNoLoad[i] = 1023;
+		table->sgFullLoad[i] = 0;
+	}
+}
+
+/* Fills one row of the table: at each calibration speed it averages a number
+** of stallGuard2 readings. Run it once with the axis unloaded and once with
+** the reference load (the load that should read 100%) applied. coolStep
+** should be off (SEMIN = 0) and the current scale at the table's cs.
+**
+** table   - table structure
+** config  - Configuration structure of the axis
+** move    - sets the speed and paces the readings
+** loaded  - 0 for the unloaded run, 1 for the reference load
+** samples - readings averaged per speed
+**
+** returns - TMC26X_SUCCESS or TMC26X_INVALID_VALUE for no samples
+*/
+int tmc26xLoadCalibrate(TMC26XLoadTable* table, TMC26XConfiguration* config, TMC26XLoadMove move, uint8_t loaded, uint8_t samples) {
+	uint32_t sum;
+	uint16_t speed;
+	uint8_t i, n;
+
+	if (!samples)
+		return TMC26X_INVALID_VALUE;
+
+	for (i=0; i<TMC26X_LOAD_POINTS; i++) {
+		speed = (i + 1) * table->speedStep;
+		for (n=0, sum=0; n<samples; n++) {
+			move(config, speed, n);
+			sum += tmc26xReadStallGuardValue(config);
+		}
+		if (loaded)
+			table->sgFullLoad[i] = sum / samples;
+		else
+			table->sgNoLoad[i] = sum / samples;
+	}
+	move(config, 0, 0);
+
+	return TMC26X_SUCCESS;
+}
+
+/* Prepares an estimator for one axis
+**
+** estimator - estimator structure
+** table     - calibration table of the axis' motor
+** smoothing - 0 for raw estimates, n to average over about 2^n samples
+*/
+void tmc26xLoadInit(TMC26XLoadEstimator* estimator, const TMC26XLoadTable* table, uint8_t smoothing) {
+	estimator->table = table;
+	estimator->smoothing = smoothing;
+	estimator->filtered = 0;
+	estimator->load = TMC26X_LOAD_UNKNOWN;
+}
+
+/* Updates the estimate with a new reading, in constant time: the speed picks
+** the two neighbouring calibration points directly.
+**
+** estimator - estimator structure
+** sg        - stallGuard2 reading
+** se        - actual current scale (coolStep readback SE, or CS without coolStep)
+** speed     - commanded speed, full steps/s
+**
+** returns - estimated load in percent of the reference load, or
+**           TMC26X_LOAD_UNKNOWN below the first calibrated speed
+*/
+uint16_t tmc26xLoadUpdate(TMC26XLoadEstimator* estimator, uint16_t sg, uint8_t se, uint16_t speed) {
+	const TMC26XLoadTable* table = estimator->table;
+	int32_t noLoad, fullLoad, span, fraction, load;
+	uint16_t index, offset;
+
+	if (!table || !table->speedStep || speed < table->speedStep)
+		return TMC26X_LOAD_UNKNOWN;
+
+	// Point i sits at (i + 1) * speedStep, beyond the last one the table is flat
+	index = speed / table->speedStep - 1;
+	offset = speed % table->speedStep;
+	if (index >= TMC26X_LOAD_POINTS - 1) {
+		index = TMC26X_LOAD_POINTS - 2;
+		offset = table->speedStep;
+	}
+
+	noLoad = table->sgNoLoad[index] + ((int32_t)table->sgNoLoad[index+1] - table->sgNoLoad[index]) * offset / table->speedStep;
+	fullLoad = table->sgFullLoad[index] + ((int32_t)table->sgFullLoad[index+1] - table->sgFullLoad[index]) * offset / table->speedStep;
+	span = noLoad - fullLoad;
+	if (span <= 0)
+		return TMC26X_LOAD_UNKNOWN;
+
+	// Fraction of the reference load at the calibration current, percent << 8
+	fraction = (noLoad - (int32_t)sg) * (100 << 8) / span;
+	if (fraction < 0)
+		fraction = 0;
+
+	// The same SG at a lower current means proportionally less torque
+	load = fraction * (se + 1) / (table->cs + 1);
+
+	if (estimator->smoothing && estimator->load != TMC26X_LOAD_UNKNOWN)
+		estimator->filtered += (load - (int32_t)estimator->filtered) >> estimator->smoothing;
+	else
+		estimator->filtered = load;
+
+	estimator->load = (estimator->filtered + 128) >> 8;
+	if (estimator->load >= TMC26X_LOAD_UNKNOWN)
+		estimator->load = TMC26X_LOAD_UNKNOWN - 1;
+
+	return estimator->load;
+}
@@ -0,0 +1,38 @@
+// Load estimation from stallGuard2 readings. A calibration table holds, for
+// evenly spaced speeds, the SG reading of the unloaded motor and the reading
+// at the reference load, both taken at the calibration current scale. The
+// estimate interpolates between the two at the present speed and scales by
+// the actual current (coolStep SE) relative to the calibration one, so it
+// stays in percent of the reference load while coolStep lowers the current.
+#ifndef TMC26X_LOAD_POINTS
+#define TMC26X_LOAD_POINTS 8
+#endif
+
+// Estimate not available (below the first calibrated speed, or no table)
+#define TMC26X_LOAD_UNKNOWN 0xFFFF
+
+typedef struct {
+	int profileID;
+	uint16_t speedStep;                         // full steps/s, point i at (i + 1) * speedStep
+	uint8_t cs;                                 // current scale during calibration (0 .. 31)
+	uint16_t sgNoLoad[TMC26X_LOAD_POINTS];
+	uint16_t sgFullLoad[TMC26X_LOAD_POINTS];
+} TMC26XLoadTable;
+
+typedef struct {
+	const TMC26XLoadTable* table;
+	uint8_t smoothing;      // 0 = none, n = exponential average over 2^n samples
+	uint32_t filtered;      // percent << 8
+	uint16_t load;          // last estimate, percent of the reference load
+} TMC26XLoadEstimator;
+
+// Called by tmc26xLoadCalibrate before every reading: with sample 0 it must
+// bring the axis to speed and let it settle, otherwise wait at least one full
+// step so the next reading is new.
+typedef void (*TMC26XLoadMove)(TMC26XConfiguration* config, uint16_t speed, uint8_t sample);
+
+
+void tmc26xLoadTableInit(TMC26XLoadTable* table, int profileID, uint16_t speedStep, uint8_t cs);
+int tmc26xLoadCalibrate(TMC26XLoadTable* table, TMC26XConfiguration* config, TMC26XLoadMove move, uint8_t loaded, uint8_t samples);
+void tmc26xLoadInit(TMC26XLoadEstimator* estimator, const TMC26XLoadTable* table, uint8_t smoothing);
+uint16_t tmc26xLoadUpdate(TMC26XLoadEstimator* estimator, uint16_t sg, uint8_t se, uint16_t speed);
@@ -0,0 +1,150 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_op.h"
+
+/* Starts a non-blocking commit of the dirty registers.
+**
+** op            - operation structure
+** config        - Configuration structure
+** SGCSCONFFirst - see tmc26xCommitConfiguration
+**
+** returns - TMC26X_SUCCESS or TMC26X_INVALID_CONFIG
+*/
+int tmc26xOperationCommit(TMC26XOperation* op, TMC26XConfiguration* config, int SGCSCONFFirst) {
+	if (config->validity != 0xFFFFFFFF)
+		return TMC26X_INVALID_CONFIG;
+
+	op->config = config;
+	op->kind = TMC26X_OPERATION_COMMIT;
+	op->SGCSCONFFirst = SGCSCONFFirst;
+
+	return TMC26X_SUCCESS;
+}
+
+/* Non-blocking tmc26xSetFullScaleCurrent. CS and VSENSE are calculated now,
+** the frames go out in the safe order on the following polls.
+**
+** op         - operation structure
+** config     - Configuration structure
+** current_mA - desired current
+**
+** returns - TMC26X_SUCCESS, TMC26X_INVALID_VALUE or TMC26X_INVALID_CONFIG
+*/
+int tmc26xOperationSetFullScaleCurrent(TMC26XOperation* op, TMC26XConfiguration* config, uint16_t current_mA) {
+	int SGCSCONFFirst;
+
+	if ((SGCSCONFFirst = tmc26xPrepareFullScaleCurrent(config, current_mA)) < 0)
+		return SGCSCONFFirst;
+
+	return tmc26xOperationCommit(op, config, SGCSCONFFirst);
+}
+
+/* Non-blocking equivalent of the tmc26xRead...Value helpers: any dirty
+** registers (including an RDSEL change) are committed first, then one
+** readback frame is sent and the value left in op->value.
+**
+** op       - operation structure
+** config   - Configuration structure
+** readback - TMC26X_READBACK_MICROSTEP, _STALLGUARD or _COOLSTEP
+**
+** returns - TMC26X_SUCCESS, TMC26X_INVALID_VALUE or TMC26X_INVALID_CONFIG
+*/
+int tmc26xOperationRead(TMC26XOperation* op, TMC26XConfiguration* config, uint8_t readback) {
+	if (config->validity != 0xFFFFFFFF)
+		return TMC26X_INVALID_CONFIG;
+
+	if (tmc26xDRVCONFGetReadbackValue(config) != readback)
+		if (tmc26xDRVCONFSetReadbackValue(config, readback) != TMC26X_SUCCESS)
+			return TMC26X_INVALID_VALUE;
+
+	op->config = config;
+	op->kind = TMC26X_OPERATION_READ;
+	op->SGCSCONFFirst = 0;
+	op->readback = readback;
+
+	return TMC26X_SUCCESS;
+}
+
+/* Sends the next dirty register in tmc26xCommitConfiguration order and
+** clears its dirty bit.
+**
+** op - operation structure
+**
+** returns - the dirty bit of the register sent, 0 if nothing was dirty
+*/
+static uint8_t tmc26xOperationCommitStep(TMC26XOperation* op) {
+	TMC26XConfiguration* config = op->config;
+	uint8_t sent;
+
+	if (op->SGCSCONFFirst && (config->dirty & TMC26X_DIRTY_BITMASK_SGCSCONF)) {
+		tmc26xSendCommand(config, config->regSGCSCONF);
+		sent = TMC26X_DIRTY_BITMASK_SGCSCONF;
+	} else if (config->dirty & TMC26X_DIRTY_BITMASK_DRVCONF) {
+		tmc26xSendCommand(config, config->regDRVCONF);
+		sent = TMC26X_DIRTY_BITMASK_DRVCONF;
+	} else if (config->dirty & TMC26X_DIRTY_BITMASK_SGCSCONF) {
+		tmc26xSendCommand(config, config->regSGCSCONF);
+		sent = TMC26X_DIRTY_BITMASK_SGCSCONF;
+	} else if (config->dirty & TMC26X_DIRTY_BITMASK_DRVCTRL) {
+		tmc26xSendCommand(config, config->regDRVCTRL);
+		sent = TMC26X_DIRTY_BITMASK_DRVCTRL;
+	} else if (config->dirty & TMC26X_DIRTY_BITMASK_CHOPCONF) {
+		tmc26xSendCommand(config, config->regCHOPCONF);
+		tmc26xSerializeStopFrames(config, config->regCHOPCONF);
+		sent = TMC26X_DIRTY_BITMASK_CHOPCONF;
+	} else if (config->dirty & TMC26X_DIRTY_BITMASK_SMARTEN) {
+		tmc26xSendCommand(config, config->regSMARTEN);
+		sent = TMC26X_DIRTY_BITMASK_SMARTEN;
+	} else
+		return 0;
+
+	config->dirty &= ~sent;
+	return sent;
+}
+
+/* Advances an operation by at most one SPI frame. Registers changed while the
+** operation runs are picked up by it. While an emergency stop is latched the
+** operation does not advance and may be polled again after the release.
+**
+** op - operation structure
+**
+** returns - TMC26X_OPERATION_PENDING while frames remain, TMC26X_SUCCESS once
+**           finished (op->value holds the result of a read), or
+**           TMC26X_EMERGENCY_STOP, also when the stop cut the current frame
+*/
+int tmc26xOperationPoll(TMC26XOperation* op) {
+	uint32_t tmp;
+	uint8_t sent;
+
+	if (op->kind == TMC26X_OPERATION_IDLE)
+		return TMC26X_SUCCESS;
+
+	if (tmc26xEmergencyStopped)
+		return TMC26X_EMERGENCY_STOP;
+
+	if ((sent = tmc26xOperationCommitStep(op))) {
+		// A stop that fired during the frame leaves that register dirty
+		if (tmc26xEmergencyStopped) {
+			op->config->dirty |= sent;
+			return TMC26X_EMERGENCY_STOP;
+		}
+		return TMC26X_OPERATION_PENDING;
+	}
+
+	if (op->kind == TMC26X_OPERATION_READ) {
+		tmp = tmc26xReadback(op->config);
+		// The response of a cut frame is meaningless, the read is retried
+		// by polling again after the release
+		if (tmc26xEmergencyStopped)
+			return TMC26X_EMERGENCY_STOP;
+		tmp >>= 10;
+		if (op->readback == TMC26X_READBACK_COOLSTEP)
+			tmp &= 0x1F;
+		op->value = (uint16_t)tmp;
+	}
+
+	op->kind = TMC26X_OPERATION_IDLE;
+
+	return TMC26X_SUCCESS;
+}
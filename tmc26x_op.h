@@ -0,0 +1,26 @@
+// Returned by tmc26xOperationPoll while the operation still has frames to send
+enum {
+	TMC26X_OPERATION_PENDING = 1
+};
+
+enum {
+	TMC26X_OPERATION_IDLE = 0,
+	TMC26X_OPERATION_COMMIT,
+	TMC26X_OPERATION_READ
+};
+
+// Structure for a resumable operation on one driver. Each poll sends at most
+// one SPI frame, so operations on many axes can be interleaved in one loop.
+typedef struct {
+	TMC26XConfiguration* config;
+	uint8_t kind;
+	uint8_t SGCSCONFFirst;
+	uint8_t readback;
+	uint16_t value;
+} TMC26XOperation;
+
+
+int tmc26xOperationCommit(TMC26XOperation* op, TMC26XConfiguration* config, int SGCSCONFFirst);
+int tmc26xOperationSetFullScaleCurrent(TMC26XOperation* op, TMC26XConfiguration* config, uint16_t current_mA);
+int tmc26xOperationRead(TMC26XOperation* op, TMC26XConfiguration* config, uint8_t readback);
+int tmc26xOperationPoll(TMC26XOperation* op);
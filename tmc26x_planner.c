@@ -0,0 +1,429 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_planner.h"
+#include "tmc26x_arch.h"
+
+#define TMC26X_PLANNER_MASK (TMC26X_PLANNER_SEGMENTS - 1)
+
+// Inverse junction speed factor (1 - sin(t/2)) / sin(t/2), Q24, where t is
+// the angle between the incoming and outgoing path (180 degrees straight on),
+// indexed by the cosine between the two directions in steps of 1/32 from -1
+// (reversal, stop) to 1 (straight, no limit). The inverse is smooth towards a
+// straight line, where the segments of a curve all sit, so linear
+// interpolation stays accurate there.
+static const uint32_t tmc26xJunctionTable[65] = {
+	0xFFFFFFFF, 117440512,  78129050,  60713425,  50331648,  43246777,
+	  38016942,  33952317,  30675917,  27962027,  25666156,  23690952,
+	  21968105,  20448084,  19093981,  17877652,  16777216,  15775365,
+	  14858206,  14014443,  13234780,  12511493,  11838100,  11209115,
+	  10619863,  10066330,   9545046,   9052998,   8587550,   8146390,
+	   7727476,   7329000,   6949350,   6587091,   6240934,   5909721,
+	   5592405,   5288043,   4995775,   4714821,   4444470,   4184071,
+	   3933029,   3690796,   3456868,   3230782,   3012108,   2800452,
+	   2595444,   2396745,   2204037,   2017025,   1835434,   1659007,
+	   1487503,   1320699,   1158382,   1000356,    846435,    696444,
+	    550218,    407603,    268453,    132628,         0
+};
+
+/* Integer square root, rounded down
+**
+** value - radicand
+**
+** returns - floor(sqrt(value))
+*/
+static uint32_t tmc26xSqrt(uint64_t value) {
+	uint64_t root = 0, bit = (uint64_t)1 << 62;
+
+	while (bit > value)
+		bit >>= 2;
+	while (bit) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return root;
+}
+
+/* Integer square root by Newton's method from a nearby value, for the step
+** rate where consecutive results differ little: one or two 32-bit divisions
+** instead of the bit by bit tmc26xSqrt.
+**
+** value - radicand
+** guess - a previous result, 0 if there is none
+**
+** returns - floor(sqrt(value))
+*/
+static uint32_t tmc26xSqrtFrom(uint32_t value, uint32_t guess) {
+	uint32_t root, next;
+
+	if (!guess || !value)
+		return tmc26xSqrt(value);
+
+	// The first step lands on or above the root from either side
+	root = ((uint64_t)guess + value / guess) / 2;
+	if (!root)
+		return tmc26xSqrt(value);
+	while ((next = (root + value / root) / 2) < root)
+		root = next;
+
+	return root;
+}
+
+/* v^2 + 2 a d, saturated
+**
+** rate2        - starting rate squared
+** acceleration - acceleration
+** distance     - distance
+**
+** returns - reachable rate squared
+*/
+static uint32_t tmc26xReachable(uint32_t rate2, uint32_t acceleration, uint32_t distance) {
+	uint64_t reach = rate2 + 2 * (uint64_t)acceleration * distance;
+
+	return reach > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)reach;
+}
+
+/* Reads the ring state the step ISR changes, consistently
+**
+** planner - planner structure
+** head    - receives the oldest segment
+** count   - receives the number of segments
+** busy    - receives whether the head is being stepped
+*/
+static void tmc26xPlannerSnapshot(TMC26XPlanner* planner, uint8_t* head, uint8_t* count, uint8_t* busy) {
+	tmc26xCriticalBegin();
+	*head = planner->head;
+	*count = planner->count;
+	*busy = planner->busy;
+	tmc26xCriticalEnd();
+}
+
+/* Empties the planner
+**
+** planner           - planner structure
+** junctionDeviation - corner tolerance in steps, Q8 (e.g. 0.8 steps is 205)
+*/
+void tmc26xPlannerInit(TMC26XPlanner* planner, uint16_t junctionDeviation) {
+	planner->head = 0;
+	planner->count = 0;
+	planner->busy = 0;
+	planner->junctionDeviation = junctionDeviation;
+}
+
+/* Works out the step generator's trapezoid for a planned segment
+**
+** segment   - segment
+** exitRate2 - planned exit rate squared, path units
+*/
+static void tmc26xPlannerProfile(TMC26XSegment* segment, uint32_t exitRate2) {
+	uint32_t acceleration, accelerate, decelerate;
+	uint64_t initial2, nominal2, final2;
+	int64_t meet;
+
+	acceleration = ((uint64_t)segment->acceleration * segment->ratio) >> 16;
+	if (!acceleration)
+		acceleration = 1;
+
+	segment->initialRate = ((uint64_t)tmc26xSqrt(segment->entryRate2) * segment->ratio) >> 16;
+	segment->nominalRate = ((uint64_t)tmc26xSqrt(segment->nominalRate2) * segment->ratio) >> 16;
+	segment->finalRate = ((uint64_t)tmc26xSqrt(exitRate2) * segment->ratio) >> 16;
+	segment->exitRate2 = exitRate2;
+	segment->majorAcceleration = acceleration;
+
+	initial2 = (uint64_t)segment->initialRate * segment->initialRate;
+	nominal2 = (uint64_t)segment->nominalRate * segment->nominalRate;
+	final2 = (uint64_t)segment->finalRate * segment->finalRate;
+
+	accelerate = (nominal2 - initial2) / (2 * acceleration);
+	decelerate = (nominal2 - final2) / (2 * acceleration);
+
+	if ((uint64_t)accelerate + decelerate <= segment->major) {
+		segment->accelerateUntil = accelerate;
+		segment->decelerateAfter = segment->major - decelerate;
+		return;
+	}
+
+	// Too short to cruise, accelerate until the two ramps meet
+	meet = ((int64_t)2 * acceleration * segment->major + (int64_t)final2 - (int64_t)initial2) / (4 * (int64_t)acceleration);
+	if (meet < 0)
+		meet = 0;
+	if (meet > segment->major)
+		meet = segment->major;
+	segment->accelerateUntil = meet;
+	segment->decelerateAfter = meet;
+}
+
+/* Replans the queued segments: a backward pass lowers entry rates so every
+** segment can still stop by the end of the queue, a forward pass lowers them
+** to what acceleration from the previous entry can reach. The entry of the
+** oldest segment not yet started is fixed, it is the exit of the one being
+** stepped (or rest).
+**
+** The step ISR may retire the segment being stepped and start the next one
+** meanwhile. Each profile is worked out on a copy and stored with interrupts
+** disabled, unless its segment has been started, in which case the pass is
+** redone from the new state.
+**
+** planner - planner structure
+*/
+static void tmc26xPlannerRecalculate(TMC26XPlanner* planner) {
+	TMC26XSegment* segment;
+	TMC26XSegment* next;
+	TMC26XSegment planned;
+	uint32_t exitRate2;
+	uint8_t head, count, first, i, started;
+
+	do {
+		tmc26xPlannerSnapshot(planner, &head, &count, &first);
+		if (!count)
+			break;
+
+		exitRate2 = 0;
+		for (i=count-1; i>first; i--) {
+			segment = &planner->segments[(head + i) & TMC26X_PLANNER_MASK];
+			segment->entryRate2 = tmc26xReachable(exitRate2, segment->acceleration, segment->length);
+			if (segment->entryRate2 > segment->maxEntryRate2)
+				segment->entryRate2 = segment->maxEntryRate2;
+			exitRate2 = segment->entryRate2;
+		}
+
+		// An idle generator starts the head from rest, a busy one hands over
+		// at the exit rate it was planned with
+		if (!first && count)
+			planner->segments[head].entryRate2 = 0;
+		if (first && count > 1) {
+			next = &planner->segments[(head + 1) & TMC26X_PLANNER_MASK];
+			if (next->entryRate2 > planner->segments[head].exitRate2)
+				next->entryRate2 = planner->segments[head].exitRate2;
+		}
+
+		for (i=first; i+1<count; i++) {
+			segment = &planner->segments[(head + i) & TMC26X_PLANNER_MASK];
+			next = &planner->segments[(head + i + 1) & TMC26X_PLANNER_MASK];
+			exitRate2 = tmc26xReachable(segment->entryRate2, segment->acceleration, segment->length);
+			if (next->entryRate2 > exitRate2)
+				next->entryRate2 = exitRate2;
+		}
+
+		started = 0;
+		for (i=first; i<count && !started; i++) {
+			segment = &planner->segments[(head + i) & TMC26X_PLANNER_MASK];
+			exitRate2 = i + 1 < count ? planner->segments[(head + i + 1) & TMC26X_PLANNER_MASK].entryRate2 : 0;
+			planned = *segment;
+			tmc26xPlannerProfile(&planned, exitRate2);
+
+			tmc26xCriticalBegin();
+			if (planner->busy && segment == &planner->segments[planner->head])
+				started = 1;
+			else {
+				segment->initialRate = planned.initialRate;
+				segment->nominalRate = planned.nominalRate;
+				segment->finalRate = planned.finalRate;
+				segment->exitRate2 = planned.exitRate2;
+				segment->accelerateUntil = planned.accelerateUntil;
+				segment->decelerateAfter = planned.decelerateAfter;
+				segment->majorAcceleration = planned.majorAcceleration;
+			}
+			tmc26xCriticalEnd();
+		}
+	} while (started);
+}
+
+/* Queues a move and replans
+**
+** planner      - planner structure
+** steps        - steps per axis, signed, at most TMC26X_PLANNER_MAX_STEPS each
+** rate         - cruise rate along the path, steps/s (at most 65535)
+** acceleration - along the path, steps/s^2
+**
+** returns - TMC26X_SUCCESS (a move of no steps is dropped),
+**           TMC26X_QUEUE_FULL or TMC26X_INVALID_VALUE
+*/
+int tmc26xPlannerAdd(TMC26XPlanner* planner, const int32_t* steps, uint32_t rate, uint32_t acceleration) {
+	TMC26XSegment* segment;
+	TMC26XSegment* previous;
+	uint64_t squares = 0, lengths;
+	int64_t dot = 0, position;
+	uint32_t magnitude, inverse;
+	uint64_t junction2;
+	uint8_t i, index, head, count, busy;
+
+	// The ISR may retire a segment meanwhile, which keeps head + count
+	tmc26xPlannerSnapshot(planner, &head, &count, &busy);
+
+	if (count == TMC26X_PLANNER_SEGMENTS)
+		return TMC26X_QUEUE_FULL;
+	if (!rate || rate > 0xFFFF || !acceleration)
+		return TMC26X_INVALID_VALUE;
+
+	segment = &planner->segments[(head + count) & TMC26X_PLANNER_MASK];
+	segment->major = 0;
+	segment->directions = 0;
+	for (i=0; i<TMC26X_PLANNER_AXES; i++) {
+		if (steps[i] > TMC26X_PLANNER_MAX_STEPS || steps[i] < -TMC26X_PLANNER_MAX_STEPS)
+			return TMC26X_INVALID_VALUE;
+		magnitude = steps[i] < 0 ? -steps[i] : steps[i];
+		if (steps[i] < 0)
+			segment->directions |= 1 << i;
+		if (magnitude > segment->major)
+			segment->major = magnitude;
+		squares += (uint64_t)magnitude * magnitude;
+		segment->steps[i] = steps[i];
+	}
+	if (!segment->major)
+		return TMC26X_SUCCESS;
+
+	segment->length = tmc26xSqrt(squares);
+	if (segment->length < segment->major)
+		segment->length = segment->major;
+	segment->ratio = ((uint64_t)segment->major << 16) / segment->length;
+	segment->acceleration = acceleration;
+	segment->nominalRate2 = rate * rate;
+	segment->entryRate2 = 0;
+	segment->maxEntryRate2 = 0;
+
+	// From rest, or through the junction with the previous segment
+	if (count) {
+		previous = &planner->segments[(head + count - 1) & TMC26X_PLANNER_MASK];
+		for (i=0; i<TMC26X_PLANNER_AXES; i++)
+			dot += (int64_t)previous->steps[i] * segment->steps[i];
+
+		// Cosine + 1 in 1/32 steps, Q16, i.e. (cosine + 1) in Q21. |dot| is
+		// at most the product of the lengths (up to 2^50), both are scaled
+		// down to 41 bits first so the Q21 quotient stays within 64 bits.
+		lengths = (uint64_t)previous->length * segment->length;
+		while (lengths >= (uint64_t)1 << 41) {
+			lengths >>= 1;
+			dot /= 2;
+		}
+		position = dot * ((int64_t)1 << 21) / (int64_t)lengths + ((int64_t)1 << 21);
+		if (position < 0)
+			position = 0;
+		if (position > (int64_t)64 << 16)
+			position = (int64_t)64 << 16;
+		index = position >> 16;
+		if (index >= 64) {
+			junction2 = 0xFFFFFFFF;
+		} else {
+			inverse = tmc26xJunctionTable[index] - (((uint64_t)(tmc26xJunctionTable[index] - tmc26xJunctionTable[index+1]) * (position & 0xFFFF)) >> 16);
+			junction2 = inverse ? (((uint64_t)acceleration * planner->junctionDeviation) << 16) / inverse : 0xFFFFFFFF;
+			if (junction2 > 0xFFFFFFFF)
+				junction2 = 0xFFFFFFFF;
+		}
+
+		segment->maxEntryRate2 = junction2;
+		if (segment->maxEntryRate2 > segment->nominalRate2)
+			segment->maxEntryRate2 = segment->nominalRate2;
+		if (segment->maxEntryRate2 > previous->nominalRate2)
+			segment->maxEntryRate2 = previous->nominalRate2;
+	}
+
+	// Planned from rest to rest until the replan, the ISR may start it as
+	// soon as it is queued (the previous segment stops there too)
+	tmc26xPlannerProfile(segment, 0);
+	tmc26xCriticalBegin();
+	planner->count++;
+	tmc26xCriticalEnd();
+	tmc26xPlannerRecalculate(planner);
+
+	return TMC26X_SUCCESS;
+}
+
+/* Attaches a step generator to a planner
+**
+** generator - generator structure
+** planner   - planner to take segments from
+*/
+void tmc26xStepGeneratorInit(TMC26XStepGenerator* generator, TMC26XPlanner* planner) {
+	generator->planner = planner;
+	generator->segment = 0;
+	generator->step = 0;
+	generator->rate = 0;
+}
+
+/* Takes the oldest queued segment for stepping, freezing its profile
+**
+** generator - generator structure
+**
+** returns - 1 if a segment was started, 0 if the queue is empty
+*/
+int tmc26xStepGeneratorStart(TMC26XStepGenerator* generator) {
+	TMC26XPlanner* planner = generator->planner;
+	TMC26XSegment* segment;
+	uint8_t i;
+
+	if (generator->segment)
+		return 1;
+	if (!planner->count)
+		return 0;
+
+	segment = &planner->segments[planner->head];
+	planner->busy = 1;
+	generator->segment = segment;
+	generator->step = 0;
+	generator->rate = 0;
+	for (i=0; i<TMC26X_PLANNER_AXES; i++)
+		generator->error[i] = segment->major / 2;
+
+	return 1;
+}
+
+/* Works out the step rate for the position reached, to be called whenever
+** the step timer period is refreshed (every step, or from a slower tick). The
+** rate is a function of the distance covered rather than of time, so the
+** profile ends exactly at the planned exit rate however often it is called.
+** On the ramps the square root is refined from the previous rate, one or two
+** 32-bit divisions per call; only the first call of a segment does the full
+** bit by bit root.
+**
+** generator - generator structure
+**
+** returns - major axis steps/s, 0 when idle. The step timer period is the
+**           timer frequency divided by this
+*/
+uint32_t tmc26xStepGeneratorRate(TMC26XStepGenerator* generator) {
+	TMC26XSegment* segment = generator->segment;
+	uint32_t rate;
+
+	if (!segment)
+		return 0;
+
+	// Rate at the end of the coming step, so a start from rest is not 0
+	if (generator->step < segment->accelerateUntil) {
+		rate = tmc26xSqrtFrom(tmc26xReachable(segment->initialRate * segment->initialRate, segment->majorAcceleration, generator->step + 1), generator->rate);
+		if (rate > segment->nominalRate)
+			rate = segment->nominalRate;
+	} else if (generator->step >= segment->decelerateAfter) {
+		rate = tmc26xSqrtFrom(tmc26xReachable(segment->finalRate * segment->finalRate, segment->majorAcceleration, segment->major - generator->step), generator->rate);
+		if (rate > segment->nominalRate)
+			rate = segment->nominalRate;
+	} else {
+		rate = segment->nominalRate;
+	}
+
+	generator->rate = rate;
+	return rate;
+}
+
+/* Releases a completed segment and starts the next one, if any
+**
+** generator - generator structure
+*/
+void tmc26xStepGeneratorDone(TMC26XStepGenerator* generator) {
+	TMC26XPlanner* planner = generator->planner;
+
+	if (!generator->segment)
+		return;
+
+	generator->segment = 0;
+	planner->head = (planner->head + 1) & TMC26X_PLANNER_MASK;
+	planner->count--;
+	planner->busy = 0;
+	tmc26xStepGeneratorStart(generator);
+}
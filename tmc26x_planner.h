@@ -0,0 +1,88 @@
+#ifndef TMC26X_PLANNER_AXES
+#define TMC26X_PLANNER_AXES 4
+#endif
+
+// Segments held for look-ahead, a power of two up to 128
+#ifndef TMC26X_PLANNER_SEGMENTS
+#define TMC26X_PLANNER_SEGMENTS 16
+#endif
+
+// Largest move per axis and segment, keeps the planner's arithmetic in range
+#define TMC26X_PLANNER_MAX_STEPS 0xFFFFFF
+
+// A straight move of all axes. Path quantities are in steps along the move
+// (Euclidean over the axes), the profile is in steps of the major axis, the
+// one with the most steps, which is what the step generator counts.
+typedef struct {
+	int32_t steps[TMC26X_PLANNER_AXES];
+	uint8_t directions;          // bit per axis, set for negative moves
+	uint32_t major;              // steps of the major axis
+	uint32_t length;             // path length
+	uint32_t ratio;              // major / length, Q16
+	uint32_t acceleration;       // path steps/s^2
+	uint32_t nominalRate2;       // path (steps/s)^2
+	uint32_t maxEntryRate2;      // junction and speed limits
+	uint32_t entryRate2;         // planned
+	uint32_t exitRate2;          // planned, fixed with the profile
+
+	// Trapezoid for the step generator
+	uint32_t initialRate;        // major steps/s
+	uint32_t nominalRate;
+	uint32_t finalRate;
+	uint32_t accelerateUntil;    // major steps
+	uint32_t decelerateAfter;
+	uint32_t majorAcceleration;  // major steps/s^2
+} TMC26XSegment;
+
+// Ring of segments, planned on every add so the axes only slow down where a
+// corner or the end of the queued path requires it. The junction speed
+// follows the junction deviation model: the corner is taken at the speed a
+// circle that deviates by junctionDeviation from the corner would allow.
+// head, count and busy are changed by the step ISR (tmc26xStepGeneratorDone)
+// and only touched with interrupts disabled elsewhere.
+typedef struct {
+	TMC26XSegment segments[TMC26X_PLANNER_SEGMENTS];
+	volatile uint8_t head;       // oldest segment
+	volatile uint8_t count;
+	volatile uint8_t busy;       // head is being stepped, its profile is fixed
+	uint16_t junctionDeviation;  // steps, Q8
+} TMC26XPlanner;
+
+// Feeds one segment to the step ISR
+typedef struct {
+	TMC26XPlanner* planner;
+	TMC26XSegment* segment;      // 0 when idle
+	uint32_t step;
+	uint32_t rate;               // major steps/s
+	uint32_t error[TMC26X_PLANNER_AXES];
+} TMC26XStepGenerator;
+
+
+void tmc26xPlannerInit(TMC26XPlanner* planner, uint16_t junctionDeviation);
+int tmc26xPlannerAdd(TMC26XPlanner* planner, const int32_t* steps, uint32_t rate, uint32_t acceleration);
+void tmc26xStepGeneratorInit(TMC26XStepGenerator* generator, TMC26XPlanner* planner);
+int tmc26xStepGeneratorStart(TMC26XStepGenerator* generator);
+uint32_t tmc26xStepGeneratorRate(TMC26XStepGenerator* generator);
+void tmc26xStepGeneratorDone(TMC26XStepGenerator* generator);
+
+// Called once per STEP period of the major axis from the step ISR. Returns
+// the axes to pulse (bit per axis, directions from segment->directions);
+// once the segment is complete, returns 0 until tmc26xStepGeneratorDone.
+static inline uint8_t tmc26xStepGeneratorStep(TMC26XStepGenerator* generator) {
+	TMC26XSegment* segment = generator->segment;
+	uint8_t i, mask = 0;
+
+	if (!segment || generator->step == segment->major)
+		return 0;
+
+	for (i=0; i<TMC26X_PLANNER_AXES; i++) {
+		generator->error[i] += segment->steps[i] < 0 ? -segment->steps[i] : segment->steps[i];
+		if (generator->error[i] >= segment->major) {
+			generator->error[i] -= segment->major;
+			mask |= 1 << i;
+		}
+	}
+	generator->step++;
+
+	return mask;
+}
@@ -0,0 +1,265 @@
+#include <stdint.h>
+#include <math.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_emu.h"
+#include "tmc26x_plant.h"
+
+// Electrical periods per revolution of a 1.8 degree motor
+#define TMC26X_PLANT_POLE_PAIRS 50
+// Longest integration step, s
+#define TMC26X_PLANT_DT 10e-6f
+// Electrical speed below which the back-EMF is too small for stallGuard2, rad/s
+#define TMC26X_PLANT_SG_MIN_SPEED 200.0f
+
+#define TMC26X_PLANT_PI 3.14159265f
+
+// Approximate data sheet values for the motors in profiles[]
+const TMC26XMotorParameters tmc26xMotorParameters[] = {
+	{MOTOR_LG_23HS7430,        1.90f, 3.0f,  0.90f, 3.4e-3f, 4.8e-5f},
+	{MOTOR_LG_23HS0420,        0.90f, 2.0f,  1.40f, 3.0e-3f, 2.8e-5f},
+	{MOTOR_NT_STM5918M1008_A,  1.87f, 2.8f,  0.80f, 1.6e-3f, 4.5e-5f},
+	{MOTOR_ZA_SY42STH47_1684A, 0.44f, 1.68f, 1.65f, 2.8e-3f, 6.8e-6f}
+};
+
+const int tmc26xMotorParameterCount = sizeof(tmc26xMotorParameters) / sizeof(TMC26XMotorParameters);
+
+/* Sets up a plant for the motor of a profile, at rest and unloaded
+**
+** plant     - plant structure
+** profileID - profile whose motor is simulated
+** rsense    - sense resistor, Ohm
+** supply    - bridge supply voltage, V
+**
+** returns - TMC26X_SUCCESS or TMC26X_INVALID_PROFILE if the motor is unknown
+*/
+int tmc26xPlantInit(TMC26XPlant* plant, int profileID, float rsense, float supply) {
+	int i;
+
+	for (i=0; i<tmc26xMotorParameterCount; i++)
+		if (tmc26xMotorParameters[i].profileID == profileID)
+			break;
+	if (i == tmc26xMotorParameterCount)
+		return TMC26X_INVALID_PROFILE;
+
+	plant->motor = &tmc26xMotorParameters[i];
+	plant->rsense = rsense;
+	plant->supply = supply;
+	plant->loadInertia = 0;
+	plant->loadTorque = 0;
+	// Rough internal damping (eddy currents, bearings)
+	plant->viscous = tmc26xMotorParameters[i].holdingTorque * 1e-3f;
+	plant->field = 0;
+	plant->angle = 0;
+	plant->velocity = 0;
+	plant->current = 0;
+	plant->time = 0;
+	plant->fullStep = 0;
+	for (i=0; i<4; i++)
+		plant->sgHistory[i] = 0;
+	plant->sgIndex = 0;
+	plant->seDownCount = 0;
+
+	return TMC26X_SUCCESS;
+}
+
+/* Returns the electrical angle of the stator field: the sine table position
+** in step/dir mode, or the angle of the coil currents written in SPI mode.
+**
+** emu - emulator structure
+**
+** returns - angle in rad
+*/
+float tmc26xPlantFieldAngle(TMC26XEmulator* emu) {
+	float a, b;
+
+	if (!(emu->DRVCONF & TMC26X_DRVCONF_DRIVEMODE_BITMASK))
+		return 2 * TMC26X_PLANT_PI * emu->mstep / 1024;
+
+	// Coil A: PHA bit 17, CA bits 9-16. Coil B: PHB bit 8, CB bits 0-7.
+	a = (emu->DRVCTRL >> 9) & 0xFF;
+	b = emu->DRVCTRL & 0xFF;
+	if (emu->DRVCTRL & ((uint32_t)1 << 17))
+		a = -a;
+	if (emu->DRVCTRL & ((uint32_t)1 << 8))
+		b = -b;
+
+	return atan2f(a, b);
+}
+
+/* Returns the lag of the rotor behind the stator field in full steps. A lag
+** beyond +-2 full steps means steps have been lost.
+**
+** plant - plant structure
+*/
+float tmc26xPlantLag(TMC26XPlant* plant) {
+	return (plant->field - plant->angle) / (TMC26X_PLANT_PI / 2);
+}
+
+// Peak coil current commanded by the chip, A
+static float tmc26xPlantCommandedCurrent(TMC26XPlant* plant, TMC26XEmulator* emu) {
+	float vfs = (emu->DRVCONF & TMC26X_DRVCONF_VSENSE_BITMASK) ? 0.165f : 0.305f;
+	float scale = (tmc26xEmuCurrentScale(emu) + 1) / 32.0f;
+	float a, b;
+
+	// Bridges off
+	if (!(emu->CHOPCONF & 0x0F))
+		return 0;
+
+	if (emu->DRVCONF & TMC26X_DRVCONF_DRIVEMODE_BITMASK) {
+		a = (emu->DRVCTRL >> 9) & 0xFF;
+		b = emu->DRVCTRL & 0xFF;
+		scale *= sqrtf(a * a + b * b) / 248;
+	}
+
+	return scale * vfs / plant->rsense;
+}
+
+// stallGuard2 measurement and coolStep regulation, once per full step
+static void tmc26xPlantMeasure(TMC26XPlant* plant, TMC26XEmulator* emu, float load) {
+	int8_t sgt = (emu->SGCSCONF >> 8) & 0x7F;
+	uint8_t semin = emu->SMARTEN & 0x0F;
+	uint8_t semax = (emu->SMARTEN >> 8) & 0x0F;
+	uint8_t seup = (emu->SMARTEN >> 5) & 0x03;
+	uint8_t sedn = (emu->SMARTEN >> 13) & 0x03;
+	uint8_t cs = emu->SGCSCONF & 0x1F;
+	float speed, sg;
+	uint8_t i;
+	uint16_t sum;
+
+	if (sgt & 0x40)
+		sgt -= 0x80;
+
+	// Positive SGT makes the reading less sensitive to load
+	sg = 1023 * (1 - load * (1 - sgt / 64.0f));
+	speed = fabsf(plant->velocity) / TMC26X_PLANT_SG_MIN_SPEED;
+	if (speed < 1)
+		sg *= speed;
+	if (sg < 0)
+		sg = 0;
+	if (sg > 1023)
+		sg = 1023;
+
+	plant->sgHistory[plant->sgIndex++ & 3] = (uint16_t)sg;
+	if (emu->SGCSCONF & ((uint32_t)1 << 16)) {
+		for (i=0, sum=0; i<4; i++)
+			sum += plant->sgHistory[i];
+		emu->sg = sum / 4;
+	} else
+		emu->sg = (uint16_t)sg;
+
+	if (emu->sg == 0)
+		emu->status |= TMC26X_STATUS_SG;
+	else
+		emu->status &= ~TMC26X_STATUS_SG;
+
+	// coolStep: raise by 1, 2, 4 or 8 below SEMIN * 32, lower by one every
+	// 32, 8, 2 or 1 measurements at or above (SEMIN + SEMAX + 1) * 32
+	if (!semin) {
+		emu->se = cs;
+		return;
+	}
+	if (emu->sg < semin * 32) {
+		emu->se += 1 << seup;
+		if (emu->se > cs)
+			emu->se = cs;
+		plant->seDownCount = 0;
+	} else if (emu->sg >= (semin + semax + 1) * 32) {
+		if (++plant->seDownCount >= (32 >> (2 * sedn))) {
+			plant->seDownCount = 0;
+			if (emu->se > 0)
+				emu->se--;
+		}
+	}
+	emu->se = tmc26xEmuCurrentScale(emu);
+}
+
+/* Advances the simulation. The coil currents follow the emulated registers,
+** limited by what the supply can push through the coil impedance against
+** the back-EMF at the present speed.
+**
+** plant - plant structure
+** emu   - emulator holding the chip state, receives sg, se and status
+** dt    - time to advance, s
+*/
+void tmc26xPlantUpdate(TMC26XPlant* plant, TMC26XEmulator* emu, float dt) {
+	const TMC26XMotorParameters* motor = plant->motor;
+	float kt = motor->holdingTorque / (motor->ratedCurrent * 1.41421356f);
+	float inertia = motor->inertia + plant->loadInertia;
+	float field = tmc26xPlantFieldAngle(emu) - fmodf(plant->field, 2 * TMC26X_PLANT_PI);
+	float step, commanded, limit, emf, impedance, torque, drive, mechanical;
+	uint16_t fullStep;
+
+	// Unwrap the field angle so the rotor can follow it over many turns
+	while (field > TMC26X_PLANT_PI)
+		field -= 2 * TMC26X_PLANT_PI;
+	while (field <= -TMC26X_PLANT_PI)
+		field += 2 * TMC26X_PLANT_PI;
+	plant->field += field;
+	field = plant->field;
+
+	while (dt > 0) {
+		step = dt < TMC26X_PLANT_DT ? dt : TMC26X_PLANT_DT;
+		dt -= step;
+
+		mechanical = plant->velocity / TMC26X_PLANT_POLE_PAIRS;
+		commanded = tmc26xPlantCommandedCurrent(plant, emu);
+		emf = kt * fabsf(mechanical);
+		impedance = sqrtf(motor->resistance * motor->resistance
+			+ plant->velocity * motor->inductance * plant->velocity * motor->inductance);
+		limit = plant->supply > emf ? (plant->supply - emf) / impedance : 0;
+		plant->current = commanded < limit ? commanded : limit;
+
+		drive = kt * plant->current * sinf(field - plant->angle);
+		torque = drive - plant->viscous * mechanical;
+
+		// Coulomb load holds the rotor while the drive torque cannot overcome it
+		if (plant->velocity > 0 || (plant->velocity == 0 && torque > plant->loadTorque))
+			torque -= plant->loadTorque;
+		else if (plant->velocity < 0 || torque < -plant->loadTorque)
+			torque += plant->loadTorque;
+		else
+			torque = 0;
+
+		mechanical += torque / inertia * step;
+		// Do not let the load reverse the rotor
+		if ((plant->velocity > 0 && mechanical < 0) || (plant->velocity < 0 && mechanical > 0))
+			mechanical = 0;
+		plant->velocity = mechanical * TMC26X_PLANT_POLE_PAIRS;
+		plant->angle += plant->velocity * step;
+		plant->time += step;
+	}
+
+	fullStep = emu->mstep >> 8;
+	if (fullStep != plant->fullStep) {
+		plant->fullStep = fullStep;
+		drive = plant->current > 0 ? fabsf(sinf(field - plant->angle)) : 1;
+		tmc26xPlantMeasure(plant, emu, drive);
+	}
+}
+
+/* Runs the motor at a constant step rate in step/dir mode, issuing STEP
+** pulses to the emulator and integrating in between.
+**
+** plant    - plant structure
+** emu      - emulator structure
+** stepRate - STEP pulses per second, negative to reverse
+** duration - s
+*/
+void tmc26xPlantMove(TMC26XPlant* plant, TMC26XEmulator* emu, float stepRate, float duration) {
+	float interval, elapsed = 0;
+	int8_t direction = stepRate < 0 ? -1 : 1;
+
+	if (stepRate == 0) {
+		tmc26xPlantUpdate(plant, emu, duration);
+		return;
+	}
+
+	interval = 1 / fabsf(stepRate);
+	while (elapsed + interval <= duration) {
+		tmc26xEmuStep(emu, direction);
+		tmc26xPlantUpdate(plant, emu, interval);
+		elapsed += interval;
+	}
+	tmc26xPlantUpdate(plant, emu, duration - elapsed);
+}
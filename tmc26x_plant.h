@@ -0,0 +1,45 @@
+// Two-phase hybrid stepper model for host simulation. Driven by the
+// registers latched in a TMC26XEmulator, it integrates the rotor (torque
+// from the coil currents and load angle, current limited by back-EMF and
+// coil impedance, inertia, coulomb and viscous load) and writes plausible
+// stallGuard2, coolStep and status values back into the emulator, updated
+// once per full step as on the chip. The stallGuard2 reading follows the
+// load angle and is not calibrated against a real motor.
+
+// Electrical and mechanical data of a motor, keyed by profile ID
+typedef struct {
+	int profileID;
+	float holdingTorque;   // Nm, both phases at rated current
+	float ratedCurrent;    // A RMS per phase
+	float resistance;      // Ohm per phase
+	float inductance;      // H per phase
+	float inertia;         // kg m^2, rotor
+} TMC26XMotorParameters;
+
+typedef struct {
+	const TMC26XMotorParameters* motor;
+	float rsense;          // Ohm
+	float supply;          // V
+	float loadInertia;     // kg m^2, added to the rotor
+	float loadTorque;      // Nm, coulomb load opposing motion
+	float viscous;         // Nm s/rad
+	float field;           // stator field electrical angle, rad, unwrapped
+	float angle;           // rotor electrical angle, rad (50 pole pairs)
+	float velocity;        // rotor electrical speed, rad/s
+	float current;         // peak phase current reached, A
+	float time;            // s
+	uint16_t fullStep;     // full step of the sine table last measured
+	uint16_t sgHistory[4];
+	uint8_t sgIndex;
+	uint8_t seDownCount;
+} TMC26XPlant;
+
+
+extern const TMC26XMotorParameters tmc26xMotorParameters[];
+extern const int tmc26xMotorParameterCount;
+
+int tmc26xPlantInit(TMC26XPlant* plant, int profileID, float rsense, float supply);
+void tmc26xPlantUpdate(TMC26XPlant* plant, TMC26XEmulator* emu, float dt);
+void tmc26xPlantMove(TMC26XPlant* plant, TMC26XEmulator* emu, float stepRate, float duration);
+float tmc26xPlantFieldAngle(TMC26XEmulator* emu);
+float tmc26xPlantLag(TMC26XPlant* plant);
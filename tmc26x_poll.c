@@ -0,0 +1,125 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_telemetry.h"
+#include "tmc26x_poll.h"
+
+// Status bits that make an axis worth watching closely
+#define TMC26X_POLL_FAULTS 0x7E
+
+/* Works out the share of the bus an axis deserves
+**
+** poller - poller structure
+** axis   - axis state
+** status - last status flags of the axis
+*/
+static void tmc26xPollWeigh(TMC26XPoller* poller, TMC26XPollAxis* axis, uint8_t status) {
+	uint32_t weight;
+
+	if (status & TMC26X_POLL_FAULTS) {
+		axis->weight = TMC26X_POLL_MAX_WEIGHT;
+		return;
+	}
+
+	weight = 1 + (axis->stepRate >> poller->rateShift) + (axis->sgVariance >> poller->varianceShift);
+	if (weight > TMC26X_POLL_MAX_WEIGHT)
+		weight = TMC26X_POLL_MAX_WEIGHT;
+	axis->weight = weight;
+}
+
+/* Sets up a poller over a group of axes sharing one bus. The shifts start at
+** 1 weight per 64 full steps/s and per 16 counts^2 of SG variance.
+**
+** poller  - poller structure
+** configs - Configuration structures of the axes, RDSEL committed
+** axes    - number of axes, at most TMC26X_TELEMETRY_MAX_AXES
+** budget  - readback frames per tick
+*/
+void tmc26xPollInit(TMC26XPoller* poller, TMC26XConfiguration** configs, uint8_t axes, uint8_t budget) {
+	uint8_t i;
+
+	if (axes > TMC26X_TELEMETRY_MAX_AXES)
+		axes = TMC26X_TELEMETRY_MAX_AXES;
+
+	for (i=0; i<axes; i++) {
+		poller->axis[i].config = configs[i];
+		poller->axis[i].stepRate = 0;
+		poller->axis[i].sgMean = 0;
+		poller->axis[i].sgVariance = 0;
+		poller->axis[i].weight = 1;
+		poller->axis[i].credit = 0;
+		poller->axis[i].reads = 0;
+		poller->samples[i].valid = 0;
+	}
+	poller->axes = axes;
+	poller->budget = budget;
+	poller->rateShift = 6;
+	poller->varianceShift = 4;
+}
+
+/* Tells the poller how fast an axis is being stepped
+**
+** poller   - poller structure
+** axis     - axis index
+** stepRate - full steps/s, 0 when stopped
+*/
+void tmc26xPollSetStepRate(TMC26XPoller* poller, uint8_t axis, uint16_t stepRate) {
+	poller->axis[axis].stepRate = stepRate;
+	tmc26xPollWeigh(poller, &poller->axis[axis], poller->samples[axis].status);
+}
+
+/* Sends the tick's readbacks. Axes are picked by smooth weighted round robin:
+** every pick adds each axis' weight to its credit and reads the axis with the
+** most credit, which then pays the total weight. Over time each axis gets
+** weight / total of the frames, spread evenly rather than in bursts. An axis
+** picked while it has uncommitted DRVCONF/SGCSCONF changes is not read and
+** its frame slot goes unused.
+**
+** poller - poller structure
+**
+** returns - frames sent
+*/
+uint8_t tmc26xPollTick(TMC26XPoller* poller) {
+	TMC26XPollAxis* axis;
+	TMC26XTelemetrySample* sample;
+	uint16_t total;
+	int32_t deviation;
+	uint8_t frame, sent = 0, i, best;
+
+	if (!poller->axes)
+		return 0;
+
+	for (frame=0; frame<poller->budget; frame++) {
+		total = 0;
+		best = 0;
+		for (i=0; i<poller->axes; i++) {
+			poller->axis[i].credit += poller->axis[i].weight;
+			total += poller->axis[i].weight;
+			if (poller->axis[i].credit > poller->axis[best].credit)
+				best = i;
+		}
+		axis = &poller->axis[best];
+		axis->credit -= total;
+
+		sample = &poller->samples[best];
+		sample->valid &= ~TMC26X_TELEMETRY_SG;
+		if (tmc26xReadTelemetry(axis->config, sample) != TMC26X_SUCCESS)
+			continue;
+		sent++;
+		axis->reads++;
+
+		// Exponential averages over about 8 readings
+		if (sample->valid & TMC26X_TELEMETRY_SG) {
+			if (axis->reads == 1)
+				axis->sgMean = sample->sg << 4;
+			deviation = ((int32_t)sample->sg << 4) - axis->sgMean;
+			axis->sgMean += deviation / 8;
+			deviation /= 16;
+			axis->sgVariance += ((int32_t)(deviation * deviation) - (int32_t)axis->sgVariance) / 8;
+		}
+
+		tmc26xPollWeigh(poller, axis, sample->status);
+	}
+
+	return sent;
+}
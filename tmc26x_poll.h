@@ -0,0 +1,34 @@
+#ifndef TMC26X_POLL_MAX_WEIGHT
+#define TMC26X_POLL_MAX_WEIGHT 64
+#endif
+
+// Per axis state of the adaptive poller
+typedef struct {
+	TMC26XConfiguration* config;
+	uint16_t stepRate;       // full steps/s, set by the motion code
+	uint16_t sgMean;         // running SG average, << 4
+	uint32_t sgVariance;     // running SG variance
+	uint16_t weight;         // share of the bus, 1 .. TMC26X_POLL_MAX_WEIGHT
+	int32_t credit;
+	uint16_t reads;
+} TMC26XPollAxis;
+
+// Shares a budget of readback frames per tick between axes in proportion to
+// their weight: a floor of 1 so nothing goes stale, plus the step rate, plus
+// the recent SG variance. An axis reporting a fault (overtemperature, short,
+// open load) gets the maximum weight. Reads use the committed RDSEL (one
+// frame each) and land in samples[], ready for tmc26xTelemetryEncode; the
+// variance is only tracked while RDSEL selects stallGuard2.
+typedef struct {
+	TMC26XPollAxis axis[TMC26X_TELEMETRY_MAX_AXES];
+	TMC26XTelemetrySample samples[TMC26X_TELEMETRY_MAX_AXES];
+	uint8_t axes;
+	uint8_t budget;          // readback frames per tick, for all axes
+	uint8_t rateShift;       // weight += stepRate >> rateShift
+	uint8_t varianceShift;   // weight += variance >> varianceShift
+} TMC26XPoller;
+
+
+void tmc26xPollInit(TMC26XPoller* poller, TMC26XConfiguration** configs, uint8_t axes, uint8_t budget);
+void tmc26xPollSetStepRate(TMC26XPoller* poller, uint8_t axis, uint16_t stepRate);
+uint8_t tmc26xPollTick(TMC26XPoller* poller);
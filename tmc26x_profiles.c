@@ -137,6 +137,41 @@ TMC26XProfileStepDirSpreadCycle profiles[] = {
 	}
 };	
 
+const int tmc26xProfileCount = sizeof(profiles) / sizeof(TMC26XProfileStepDirSpreadCycle);
+
+// Profiles registered at run-time (e.g. loaded from EEPROM blobs by
+// tmc26xBlobLoadImage). These take precedence over the built-in profiles.
+#ifndef TMC26X_MAX_LOADED_PROFILES
+#define TMC26X_MAX_LOADED_PROFILES 4
+#endif
+
+static TMC26XProfileStepDirSpreadCycle loadedProfiles[TMC26X_MAX_LOADED_PROFILES];
+static uint8_t loadedProfileCount = 0;
+
+/* Adds a profile to the run-time registry. A profile with the same ID as one
+** already registered replaces it, so pushing a new blob updates a motor in place.
+**
+** profile - profile to copy into the registry
+**
+** returns - TMC26X_SUCCESS or TMC26X_INVALID_PROFILE if the registry is full
+*/
+int tmc26xRegisterProfile(const TMC26XProfileStepDirSpreadCycle* profile) {
+	uint8_t i;
+
+	for (i=0; i<loadedProfileCount; i++)
+		if (loadedProfiles[i].profileID == profile->profileID)
+			break;
+
+	if (i == TMC26X_MAX_LOADED_PROFILES)
+		return TMC26X_INVALID_PROFILE;
+
+	loadedProfiles[i] = *profile;
+	if (i == loadedProfileCount)
+		loadedProfileCount++;
+
+	return TMC26X_SUCCESS;
+}
+
 /* This function applies a profile structure, of the form DRIVEMODE: Step/Dir, CHOPPER: SpreadCycle, to
 ** a configuration structure, then syncs this profile to the TMC261/262 chip.
 **
@@ -191,6 +226,9 @@ int tmc26xSetProfileStepDirSpreadCycle(TMC26XConfiguration* config, TMC26XProfil
 
 /* This function searches through the list of profiles for the profile
 ** in question and then tries to apply it to the config and TMC chip.
+** Run-time registered profiles are searched before the built-in ones.
+** The configuration is reinitialized except for its axis, so it must have
+** been through TMC26XConfiguration_Init once.
 **
 ** config       - The Configuration profile to apply the profile to
 ** motorProfile - Constant integer  to match to the .profileID of the profile
@@ -199,11 +237,22 @@ int tmc26xSetProfileStepDirSpreadCycle(TMC26XConfiguration* config, TMC26XProfil
 ** returns      - TMC26X_SUCCESS if succesful, otherwise TMC26X_SUCCESS
 */
 int initializeTMC26XWithProfile(TMC26XConfiguration* config, int motorProfile) {
+	uint8_t axis = config->axis;
 	int i;
+	//Run-time registered profiles
+	for (i=0; i<loadedProfileCount; i++)
+		if (loadedProfiles[i].profileID == motorProfile) {
+			TMC26XConfiguration_Init(config);
+			config->axis = axis;
+			tmc26xSetProfileStepDirSpreadCycle(config, &loadedProfiles[i]);
+			return TMC26X_SUCCESS;
+		}
+
 	//Basic configuration
-	for (i=0; i<sizeof(profiles) / sizeof(TMC26XProfileStepDirSpreadCycle); i++)
+	for (i=0; i<tmc26xProfileCount; i++)
 		if (profiles[i].profileID == motorProfile) {
 			TMC26XConfiguration_Init(config);
+			config->axis = axis;
 			tmc26xSetProfileStepDirSpreadCycle(config, &profiles[i]);
 			return TMC26X_SUCCESS;
 		}
@@ -220,6 +269,7 @@ void unitTestTMC26X(int motorProfile) {
 	TMC26XConfiguration _config;
 	TMC26XConfiguration* config = &_config;
 	
+	TMC26XConfiguration_Init(config);
 	initializeTMC26XWithProfile(config, motorProfile);
 }
 
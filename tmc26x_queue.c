@@ -0,0 +1,284 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_queue.h"
+
+/* Returns the register address bits of a command. DRVCTRL is the only
+** register addressed by bit 19 alone, the others use bits 17-19.
+**
+** command - 20-bit register write
+**
+** returns - the register address (TMC26X_..._ADDRESS)
+*/
+static uint32_t tmc26xCommandAddress(uint32_t command) {
+	if (!(command & 0x80000))
+		return TMC26X_DRVCTRL_ADDRESS;
+	return command & 0xE0000;
+}
+
+/* Initializes an empty transaction queue for one SPI bus
+**
+** queue - queue structure
+*/
+void tmc26xQueueInit(TMC26XQueue* queue) {
+	uint8_t i;
+
+	for (i=0; i<TMC26X_QUEUE_CLASSES; i++) {
+		queue->head[i] = 0;
+		queue->used[i] = 0;
+		queue->stats[i].sent = 0;
+		queue->stats[i].coalesced = 0;
+		queue->stats[i].totalLatency = 0;
+		queue->stats[i].maxLatency = 0;
+	}
+}
+
+/* Tells whether a write to the other register of the DRVCONF/SGCSCONF pair of
+** the same axis is queued behind an entry. Coalescing such an entry in place
+** would change the order of the pair.
+**
+** queue    - queue structure
+** priority - class of the entry
+** index    - position of the entry, counted from the head of the class
+**
+** returns - 1 if the pair order depends on the entry staying in place
+*/
+static int tmc26xQueuePairFollows(TMC26XQueue* queue, uint8_t priority, uint8_t index) {
+	TMC26XQueueEntry* entry = &queue->entries[priority][(queue->head[priority] + index) % TMC26X_QUEUE_LENGTH];
+	TMC26XQueueEntry* later;
+	uint32_t address = tmc26xCommandAddress(entry->command), partner;
+	uint8_t i;
+
+	if (address == TMC26X_DRVCONF_ADDRESS)
+		partner = TMC26X_SGCSCONF_ADDRESS;
+	else if (address == TMC26X_SGCSCONF_ADDRESS)
+		partner = TMC26X_DRVCONF_ADDRESS;
+	else
+		return 0;
+
+	for (i=index+1; i<queue->used[priority]; i++) {
+		later = &queue->entries[priority][(queue->head[priority] + i) % TMC26X_QUEUE_LENGTH];
+		if (later->config == entry->config && !later->read
+		 && tmc26xCommandAddress(later->command) == partner)
+			return 1;
+	}
+	return 0;
+}
+
+/* Tells whether a queued read can be sent: the RDSEL it would write must be
+** the one the chip will keep, so the read waits while the axis' DRVCONF or
+** SGCSCONF has uncommitted changes or queued writes in any class.
+**
+** queue  - queue structure
+** config - Configuration structure of the axis read
+**
+** returns - 1 if the read can go out now
+*/
+static int tmc26xQueueReadReady(TMC26XQueue* queue, TMC26XConfiguration* config) {
+	TMC26XQueueEntry* entry;
+	uint32_t address;
+	uint8_t i, j;
+
+	if (config->dirty & (TMC26X_DIRTY_BITMASK_DRVCONF | TMC26X_DIRTY_BITMASK_SGCSCONF))
+		return 0;
+
+	for (i=0; i<TMC26X_QUEUE_CLASSES; i++)
+		for (j=0; j<queue->used[i]; j++) {
+			entry = &queue->entries[i][(queue->head[i] + j) % TMC26X_QUEUE_LENGTH];
+			address = tmc26xCommandAddress(entry->command);
+			if (entry->config == config && !entry->read
+			 && (address == TMC26X_DRVCONF_ADDRESS || address == TMC26X_SGCSCONF_ADDRESS))
+				return 0;
+		}
+	return 1;
+}
+
+/* Queues a single register write. A write to a register of the same axis that
+** is still waiting in the same class is replaced in place, keeping the
+** ordering of a queued commit. A queued write is never moved behind another
+** one, so a DRVCONF or SGCSCONF write with the other register of the pair
+** queued behind it is left alone and the new write appended after the pair:
+** the chip then goes through every state of the queued commit, each of which
+** was ordered safely against the one before. Frames with a callback are never
+** coalesced, their response is wanted, and neither are writes queued before
+** one.
+**
+** queue    - queue structure
+** priority - TMC26X_QUEUE_SAFETY .. TMC26X_QUEUE_SCRUB
+** config   - Configuration structure of the target axis
+** command  - 20-bit register write
+** callback - called with the response once sent, or 0
+** now      - current time, in the units used for the latency counters
+**
+** returns - TMC26X_SUCCESS, TMC26X_INVALID_VALUE for a bad priority or
+**           TMC26X_QUEUE_FULL
+*/
+int tmc26xQueueSubmit(TMC26XQueue* queue, uint8_t priority, TMC26XConfiguration* config, uint32_t command, TMC26XQueueCallback callback, uint16_t now) {
+	TMC26XQueueEntry* entry;
+	uint8_t i, slot;
+
+	if (priority >= TMC26X_QUEUE_CLASSES)
+		return TMC26X_INVALID_VALUE;
+
+	// Only the latest queued write of the register can take the new value
+	if (!callback) {
+		for (i=queue->used[priority]; i>0; i--) {
+			entry = &queue->entries[priority][(queue->head[priority] + i - 1) % TMC26X_QUEUE_LENGTH];
+			if (entry->config == config
+			 && tmc26xCommandAddress(entry->command) == tmc26xCommandAddress(command)) {
+				if (!entry->callback && !tmc26xQueuePairFollows(queue, priority, i - 1)) {
+					queue->stats[priority].coalesced++;
+					entry->command = command;
+					return TMC26X_SUCCESS;
+				}
+				break;
+			}
+		}
+	}
+
+	if (queue->used[priority] == TMC26X_QUEUE_LENGTH)
+		return TMC26X_QUEUE_FULL;
+
+	slot = (queue->head[priority] + queue->used[priority]) % TMC26X_QUEUE_LENGTH;
+	entry = &queue->entries[priority][slot];
+	entry->config = config;
+	entry->command = command;
+	entry->callback = callback;
+	entry->enqueued = now;
+	entry->read = 0;
+	queue->used[priority]++;
+
+	return TMC26X_SUCCESS;
+}
+
+/* Queued equivalent of tmc26xCommitConfiguration. The dirty registers are
+** queued in the same safe order and the dirty bits cleared; nothing is queued
+** unless all of them fit.
+**
+** queue         - queue structure
+** priority      - class to queue the writes in
+** config        - Configuration structure
+** SGCSCONFFirst - see tmc26xCommitConfiguration
+** now           - current time
+**
+** returns - TMC26X_SUCCESS, TMC26X_INVALID_CONFIG or TMC26X_QUEUE_FULL
+*/
+int tmc26xQueueCommit(TMC26XQueue* queue, uint8_t priority, TMC26XConfiguration* config, int SGCSCONFFirst, uint16_t now) {
+	uint8_t needed = 0, bit;
+
+	if (config->validity != 0xFFFFFFFF)
+		return TMC26X_INVALID_CONFIG;
+
+	if (priority >= TMC26X_QUEUE_CLASSES)
+		return TMC26X_INVALID_VALUE;
+
+	// Worst case, assuming nothing coalesces
+	for (bit=1; bit<=TMC26X_DIRTY_BITMASK_DRVCONF; bit<<=1)
+		if (config->dirty & bit)
+			needed++;
+	if (queue->used[priority] + needed > TMC26X_QUEUE_LENGTH)
+		return TMC26X_QUEUE_FULL;
+
+	if (SGCSCONFFirst == 1 && (config->dirty & TMC26X_DIRTY_BITMASK_SGCSCONF))
+		tmc26xQueueSubmit(queue, priority, config, config->regSGCSCONF, 0, now);
+
+	if (config->dirty & TMC26X_DIRTY_BITMASK_DRVCONF)
+		tmc26xQueueSubmit(queue, priority, config, config->regDRVCONF, 0, now);
+
+	if (SGCSCONFFirst == 0 && (config->dirty & TMC26X_DIRTY_BITMASK_SGCSCONF))
+		tmc26xQueueSubmit(queue, priority, config, config->regSGCSCONF, 0, now);
+
+	if (config->dirty & TMC26X_DIRTY_BITMASK_DRVCTRL)
+		tmc26xQueueSubmit(queue, priority, config, config->regDRVCTRL, 0, now);
+
+	if (config->dirty & TMC26X_DIRTY_BITMASK_CHOPCONF)
+		tmc26xQueueSubmit(queue, priority, config, config->regCHOPCONF, 0, now);
+
+	if (config->dirty & TMC26X_DIRTY_BITMASK_SMARTEN)
+		tmc26xQueueSubmit(queue, priority, config, config->regSMARTEN, 0, now);
+
+	config->dirty = 0;
+
+	return TMC26X_SUCCESS;
+}
+
+/* Queues a readback: a DRVCONF write whose response carries the value
+** selected by RDSEL. The DRVCONF value is taken from the shadow when the frame
+** is sent, so the callback can decode the response with config->regDRVCONF.
+** The read waits, holding up its class, while DRVCONF or SGCSCONF has changes
+** that are not yet committed or still queued.
+**
+** queue    - queue structure
+** priority - normally TMC26X_QUEUE_TELEMETRY
+** config   - Configuration structure
+** callback - receives the 20-bit response
+** now      - current time
+**
+** returns - see tmc26xQueueSubmit, TMC26X_INVALID_VALUE without a callback
+*/
+int tmc26xQueueRead(TMC26XQueue* queue, uint8_t priority, TMC26XConfiguration* config, TMC26XQueueCallback callback, uint16_t now) {
+	int error;
+
+	if (!callback)
+		return TMC26X_INVALID_VALUE;
+
+	if ((error = tmc26xQueueSubmit(queue, priority, config, TMC26X_DRVCONF_ADDRESS, callback, now)) < 0)
+		return error;
+
+	queue->entries[priority][(queue->head[priority] + queue->used[priority] - 1) % TMC26X_QUEUE_LENGTH].read = 1;
+	return TMC26X_SUCCESS;
+}
+
+/* Sends the oldest frame of the highest priority class that has one ready. One
+** frame per call bounds the wait of a newly queued safety or motion write to
+** the frame already on the bus. A class whose oldest frame is a read of an
+** axis with pending DRVCONF/SGCSCONF changes is passed over. Nothing is
+** dequeued while an emergency stop is latched.
+**
+** queue - queue structure
+** now   - current time, latency is now minus the time the frame was queued
+**
+** returns - 1 if a frame was sent, 0 if nothing is ready or the bus stopped
+*/
+int tmc26xQueueService(TMC26XQueue* queue, uint16_t now) {
+	TMC26XQueueEntry entry;
+	TMC26XQueueStats* stats;
+	uint16_t latency;
+	uint32_t response;
+	uint8_t i;
+
+	if (tmc26xEmergencyStopped)
+		return 0;
+
+	for (i=0; i<TMC26X_QUEUE_CLASSES; i++) {
+		if (!queue->used[i])
+			continue;
+		entry = queue->entries[i][queue->head[i]];
+		if (!entry.read || tmc26xQueueReadReady(queue, entry.config))
+			break;
+	}
+	if (i == TMC26X_QUEUE_CLASSES)
+		return 0;
+
+	queue->head[i] = (queue->head[i] + 1) % TMC26X_QUEUE_LENGTH;
+	queue->used[i]--;
+
+	if (entry.read)
+		entry.command = entry.config->regDRVCONF;
+
+	response = tmc26xSendCommand(entry.config, entry.command);
+	if (tmc26xCommandAddress(entry.command) == TMC26X_CHOPCONF_ADDRESS)
+		tmc26xSerializeStopFrames(entry.config, entry.command);
+
+	latency = now - entry.enqueued;
+	stats = &queue->stats[i];
+	stats->sent++;
+	stats->totalLatency += latency;
+	if (latency > stats->maxLatency)
+		stats->maxLatency = latency;
+
+	if (entry.callback)
+		entry.callback(entry.config, response);
+
+	return 1;
+}
@@ -0,0 +1,46 @@
+#ifndef TMC26X_QUEUE_LENGTH
+#define TMC26X_QUEUE_LENGTH 4
+#endif
+
+// Priority classes, lower value is served first
+enum {
+	TMC26X_QUEUE_SAFETY = 0,
+	TMC26X_QUEUE_MOTION = 1,
+	TMC26X_QUEUE_TELEMETRY = 2,
+	TMC26X_QUEUE_SCRUB = 3,
+	TMC26X_QUEUE_CLASSES = 4
+};
+
+// Called with the 20-bit response once a queued frame has been sent
+typedef void (*TMC26XQueueCallback)(TMC26XConfiguration* config, uint32_t response);
+
+typedef struct {
+	TMC26XConfiguration* config;
+	uint32_t command;
+	TMC26XQueueCallback callback;
+	uint16_t enqueued;
+	uint8_t read;          // command is taken from regDRVCONF when sent
+} TMC26XQueueEntry;
+
+// Latencies are in the caller's time units (see tmc26xQueueService)
+typedef struct {
+	uint32_t sent;
+	uint32_t coalesced;
+	uint32_t totalLatency;
+	uint16_t maxLatency;
+} TMC26XQueueStats;
+
+// Structure for one SPI bus' transaction queue
+typedef struct {
+	TMC26XQueueEntry entries[TMC26X_QUEUE_CLASSES][TMC26X_QUEUE_LENGTH];
+	uint8_t head[TMC26X_QUEUE_CLASSES];
+	uint8_t used[TMC26X_QUEUE_CLASSES];
+	TMC26XQueueStats stats[TMC26X_QUEUE_CLASSES];
+} TMC26XQueue;
+
+
+void tmc26xQueueInit(TMC26XQueue* queue);
+int tmc26xQueueSubmit(TMC26XQueue* queue, uint8_t priority, TMC26XConfiguration* config, uint32_t command, TMC26XQueueCallback callback, uint16_t now);
+int tmc26xQueueCommit(TMC26XQueue* queue, uint8_t priority, TMC26XConfiguration* config, int SGCSCONFFirst, uint16_t now);
+int tmc26xQueueRead(TMC26XQueue* queue, uint8_t priority, TMC26XConfiguration* config, TMC26XQueueCallback callback, uint16_t now);
+int tmc26xQueueService(TMC26XQueue* queue, uint16_t now);
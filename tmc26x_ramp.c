@@ -0,0 +1,173 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_ramp.h"
+
+/* Returns the VSENSE in use by a configuration
+**
+** config - Configuration structure
+**
+** returns - TMC26X_VSENSE_FULL or TMC26X_VSENSE_HALFISH
+*/
+static uint16_t tmc26xRampVSense(const TMC26XConfiguration* config) {
+	if (config->regDRVCONF & TMC26X_DRVCONF_VSENSE_BITMASK)
+		return TMC26X_VSENSE_HALFISH;
+	return TMC26X_VSENSE_FULL;
+}
+
+/* Works out the setting one step closer to the target. The current is
+** proportional to scale * VSENSE; at the boundary the neighbouring setting of
+** the other range is the one closest in current, so the crossing is a step
+** like the others.
+**
+** ramp   - ramp structure holding the target
+** vsense - present VSENSE, updated
+** scale  - present scale (1 .. 32), updated
+**
+** returns - 1 if VSENSE changes, 0 otherwise
+*/
+static uint8_t tmc26xRampNext(const TMC26XRamp* ramp, uint16_t* vsense, uint8_t* scale) {
+	if (*vsense == ramp->targetVSense) {
+		if (*scale < ramp->targetScale)
+			(*scale)++;
+		else if (*scale > ramp->targetScale)
+			(*scale)--;
+		return 0;
+	}
+
+	// Going up from the 165 mV range: top it out, then the lowest 305 mV
+	// setting above it
+	if (*vsense == TMC26X_VSENSE_HALFISH) {
+		if (*scale < 32) {
+			(*scale)++;
+			return 0;
+		}
+		*vsense = TMC26X_VSENSE_FULL;
+		*scale = 32 * TMC26X_VSENSE_HALFISH / TMC26X_VSENSE_FULL + 1;
+		return 1;
+	}
+
+	// Going down: stay in the 305 mV range while the next setting is above
+	// what the 165 mV range can reach
+	if ((uint16_t)(*scale - 1) * TMC26X_VSENSE_FULL > 32 * TMC26X_VSENSE_HALFISH) {
+		(*scale)--;
+		return 0;
+	}
+	*scale = (uint16_t)(*scale - 1) * TMC26X_VSENSE_FULL / TMC26X_VSENSE_HALFISH;
+	if (*scale < 1)
+		*scale = 1;
+	*vsense = TMC26X_VSENSE_HALFISH;
+	return 1;
+}
+
+/* Starts a ramp from the committed current to a new one. The target CS and
+** VSENSE are those tmc26xSetFullScaleCurrent would choose. With more steps
+** than ticks the ramp makes one step per tick and takes longer.
+**
+** ramp       - ramp structure
+** config     - Configuration structure, fully committed
+** current_mA - target current
+** duration   - ticks the ramp should take
+**
+** returns - TMC26X_SUCCESS, TMC26X_INVALID_VALUE or TMC26X_INVALID_CONFIG
+*/
+int tmc26xRampStart(TMC26XRamp* ramp, TMC26XConfiguration* config, uint16_t current_mA, uint16_t duration) {
+	TMC26XConfiguration target;
+	uint16_t vsense;
+	uint8_t scale;
+	int result;
+
+	if (config->validity != 0xFFFFFFFF)
+		return TMC26X_INVALID_CONFIG;
+
+	target = *config;
+	if ((result = tmc26xPrepareFullScaleCurrent(&target, current_mA)) < 0)
+		return result;
+
+	ramp->config = config;
+	ramp->targetVSense = tmc26xRampVSense(&target);
+	ramp->targetScale = (target.regSGCSCONF & 0x1F) + 1;
+	ramp->duration = duration;
+	ramp->accumulator = 0;
+
+	vsense = tmc26xRampVSense(config);
+	scale = (config->regSGCSCONF & 0x1F) + 1;
+	for (ramp->steps=0; vsense != ramp->targetVSense || scale != ramp->targetScale; ramp->steps++)
+		tmc26xRampNext(ramp, &vsense, &scale);
+	ramp->total = ramp->steps;
+
+	return TMC26X_SUCCESS;
+}
+
+/* Ramps to the driving current stored in the configuration structure
+**
+** ramp     - ramp structure
+** config   - Configuration structure
+** duration - ticks the ramp should take
+**
+** returns - see tmc26xRampStart
+*/
+int tmc26xRampToDrivingCurrent(TMC26XRamp* ramp, TMC26XConfiguration* config, uint16_t duration) {
+	return tmc26xRampStart(ramp, config, config->drivingCurrent, duration);
+}
+
+/* Ramps to the standstill current stored in the configuration structure
+**
+** ramp     - ramp structure
+** config   - Configuration structure
+** duration - ticks the ramp should take
+**
+** returns - see tmc26xRampStart
+*/
+int tmc26xRampToStationaryCurrent(TMC26XRamp* ramp, TMC26XConfiguration* config, uint16_t duration) {
+	return tmc26xRampStart(ramp, config, config->stationaryCurrent, duration);
+}
+
+/* Advances the ramp, to be called from a periodic tick. A step sends one
+** SGCSCONF frame, or at the VSENSE boundary SGCSCONF and DRVCONF in the safe
+** order; ticks between steps send nothing.
+**
+** ramp - ramp structure
+**
+** returns - 1 while the ramp is running, 0 once the target is reached, or
+**           TMC26X_EMERGENCY_STOP (the step is retried on the next tick)
+*/
+int tmc26xRampTick(TMC26XRamp* ramp) {
+	TMC26XConfiguration* config = ramp->config;
+	uint16_t vsense;
+	uint8_t scale;
+	int result;
+
+	if (!ramp->steps)
+		return 0;
+
+	if (tmc26xEmergencyStopped)
+		return TMC26X_EMERGENCY_STOP;
+
+	// Spread the steps evenly over the duration, at most one per tick
+	if (ramp->duration > ramp->total) {
+		ramp->accumulator += ramp->total;
+		if (ramp->accumulator < ramp->duration)
+			return 1;
+		ramp->accumulator -= ramp->duration;
+	}
+
+	vsense = tmc26xRampVSense(config);
+	scale = (config->regSGCSCONF & 0x1F) + 1;
+
+	if (tmc26xRampNext(ramp, &vsense, &scale)) {
+		tmc26xSGCSCONFSetCurrentScale(config, scale);
+		tmc26xDRVCONFSetMaximumRSenseVoltage(config, vsense);
+		// CS before a switch to 305 mV, after a switch to 165 mV
+		if ((result = tmc26xCommitConfiguration(config, vsense == TMC26X_VSENSE_FULL)) != TMC26X_SUCCESS)
+			return result;
+	} else {
+		tmc26xSGCSCONFSetCurrentScale(config, scale);
+		tmc26xSendCommand(config, config->regSGCSCONF);
+		config->dirty &= ~TMC26X_DIRTY_BITMASK_SGCSCONF;
+	}
+
+	ramp->steps--;
+
+	return ramp->steps ? 1 : 0;
+}
@@ -0,0 +1,20 @@
+// Moves the current scale to a new current one CS step per ramp step instead
+// of in one jump, spreading the steps evenly over a number of ticks. A step
+// within one VSENSE range is a single SGCSCONF frame; the step across the
+// 165 mV / 305 mV boundary changes CS and VSENSE together and is committed in
+// the safe order used by tmc26xSetFullScaleCurrent.
+typedef struct {
+	TMC26XConfiguration* config;
+	uint16_t targetVSense;
+	uint8_t targetScale;     // 1 .. 32, as passed to tmc26xSGCSCONFSetCurrentScale
+	uint8_t steps;           // steps left
+	uint8_t total;           // steps of the whole ramp
+	uint16_t duration;       // ticks the whole ramp should take
+	uint16_t accumulator;
+} TMC26XRamp;
+
+
+int tmc26xRampStart(TMC26XRamp* ramp, TMC26XConfiguration* config, uint16_t current_mA, uint16_t duration);
+int tmc26xRampToDrivingCurrent(TMC26XRamp* ramp, TMC26XConfiguration* config, uint16_t duration);
+int tmc26xRampToStationaryCurrent(TMC26XRamp* ramp, TMC26XConfiguration* config, uint16_t duration);
+int tmc26xRampTick(TMC26XRamp* ramp);
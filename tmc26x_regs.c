@@ -35,18 +35,22 @@ static void alterRegisterValue(uint32_t* reg, int bitPos, int bitWidth, uint16_t
 static uint16_t retrieveRegisterValue(uint32_t* reg, int bitPos, int bitWidth) {
 	uint32_t mask;
 	mask = 1;
-	mask = ~(((mask << bitWidth) - 1) << bitPos);
+	mask = ((mask << bitWidth) - 1) << bitPos;
 	mask &= *reg;
 	mask >>= bitPos;
 	return (uint16_t)mask;
 }
 
 /* Initializes a TMC26XConfiguration structure (all zeroes, except for the register
-** address bits
+** address bits). The axis is 0, boards with several drivers set config->axis
+** afterwards; initializeTMC26XWithProfile keeps it. The emergency stop frames
+** stay zero until CHOPCONF is first committed.
 **
 ** config - configuration structure
 */
 void TMC26XConfiguration_Init(TMC26XConfiguration* config) {
+	uint8_t i;
+
 	config->regDRVCTRL =  TMC26X_DRVCTRL_ADDRESS;
 	config->regCHOPCONF = TMC26X_CHOPCONF_ADDRESS;
 	config->regSMARTEN =  TMC26X_SMARTEN_ADDRESS;
@@ -55,6 +59,11 @@ void TMC26XConfiguration_Init(TMC26XConfiguration* config) {
 	config->validity = (~(TMC26X_VALID_BITMASK_DRVCONF_END_BIT - 1)) | TMC26X_VALID_BITMASK_DRVCTRL_BIT3_ALWAYS_ONE;
 	config->dirty = TMC26X_DIRTY_BITMASK_DRVCTRL | TMC26X_DIRTY_BITMASK_CHOPCONF | TMC26X_DIRTY_BITMASK_SMARTEN |
 	                TMC26X_DIRTY_BITMASK_SGCSCONF | TMC26X_DIRTY_BITMASK_DRVCONF;
+	config->axis = 0;
+	for (i=0; i<3; i++) {
+		config->stopFrame[i] = 0;
+		config->runFrame[i] = 0;
+	}
 }
 
 
@@ -0,0 +1,170 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_resonance.h"
+
+// 2 cos(2 pi k / 64) in Q13, k = 0 .. 31
+static const int16_t tmc26xGoertzelCoefficients[32] = {
+	16384, 16305, 16069, 15679, 15137, 14449, 13623, 12665,
+	11585, 10394, 9102, 7723, 6270, 4756, 3196, 1606,
+	0, -1606, -3196, -4756, -6270, -7723, -9102, -10394,
+	-11585, -12665, -13623, -14449, -15137, -15679, -16069, -16305
+};
+
+/* Prepares a detector with no resonant bands known
+**
+** detector     - detector structure
+** sampleRate   - rate at which tmc26xResonanceSample is called, Hz
+** minimumPower - bin power below which nothing counts as resonance; an SG
+**                oscillation of amplitude A centred on a bin gives about A^2 / 4
+** bandWidth    - width of the band marked around a resonant step rate, in
+**                percent of that rate
+*/
+void tmc26xResonanceInit(TMC26XResonance* detector, uint16_t sampleRate, uint16_t minimumPower, uint8_t bandWidth) {
+	uint8_t k;
+
+	for (k=0; k<TMC26X_RESONANCE_BINS; k++) {
+		detector->s1[k] = 0;
+		detector->s2[k] = 0;
+		detector->power[k] = 0;
+	}
+	detector->sum = 0;
+	detector->mean = 0xFFFF;
+	detector->sampleRate = sampleRate;
+	detector->minimumPower = minimumPower;
+	detector->rateLow = 0xFFFF;
+	detector->rateHigh = 0;
+	detector->count = 0;
+	detector->dominant = 0;
+	detector->frequency = 0;
+	detector->resonant = 0;
+	detector->bandWidth = bandWidth;
+	detector->bandCount = 0;
+}
+
+// Adds rate +- bandWidth / 2 percent to the bands, merging overlaps
+static void tmc26xResonanceMark(TMC26XResonance* detector, uint16_t rate) {
+	uint16_t half = (uint32_t)rate * detector->bandWidth / 200;
+	uint16_t low = rate - half, high = rate + half;
+	TMC26XResonanceBand* band;
+	uint8_t i;
+
+	for (i=0; i<detector->bandCount; i++) {
+		band = &detector->bands[i];
+		if (low <= band->high && high >= band->low) {
+			if (low < band->low)
+				band->low = low;
+			if (high > band->high)
+				band->high = high;
+			return;
+		}
+	}
+
+	// Full: the oldest band makes way
+	if (detector->bandCount == TMC26X_RESONANCE_BANDS) {
+		for (i=1; i<TMC26X_RESONANCE_BANDS; i++)
+			detector->bands[i-1] = detector->bands[i];
+		detector->bandCount--;
+	}
+	detector->bands[detector->bandCount].low = low;
+	detector->bands[detector->bandCount].high = high;
+	detector->bandCount++;
+}
+
+// Bin powers at the end of a window, and the resonance decision
+static void tmc26xResonanceFinish(TMC26XResonance* detector, uint16_t stepRate) {
+	uint32_t total = 0, best = 0;
+	int32_t a, b, p;
+	uint8_t k;
+
+	for (k=0; k<TMC26X_RESONANCE_BINS; k++) {
+		// Scaled down so the products fit 32 bits
+		a = detector->s1[k] >> 4;
+		b = detector->s2[k] >> 4;
+		p = a * a + b * b - ((tmc26xGoertzelCoefficients[k+1] * a) >> 13) * b;
+		// Rounding can take an empty bin just below zero
+		detector->power[k] = p > 0 ? p : 0;
+		total += detector->power[k];
+		if (detector->power[k] > best) {
+			best = detector->power[k];
+			detector->dominant = k + 1;
+		}
+		detector->s1[k] = 0;
+		detector->s2[k] = 0;
+	}
+
+	detector->frequency = (uint32_t)detector->dominant * detector->sampleRate / TMC26X_RESONANCE_WINDOW;
+	detector->resonant = best >= detector->minimumPower
+		&& best / TMC26X_RESONANCE_RATIO > (total - best) / (TMC26X_RESONANCE_BINS - 1);
+
+	// Only a window taken at a steady speed says which speed resonates
+	if (detector->resonant && stepRate && detector->rateHigh - detector->rateLow <= detector->rateHigh / 16)
+		tmc26xResonanceMark(detector, stepRate);
+
+	detector->mean = detector->sum / TMC26X_RESONANCE_WINDOW;
+	detector->sum = 0;
+	detector->count = 0;
+	detector->rateLow = 0xFFFF;
+	detector->rateHigh = 0;
+}
+
+/* Adds one stallGuard2 reading. Readings must arrive at the sample rate given
+** to tmc26xResonanceInit, e.g. from a periodic tmc26xReadStallGuardValue.
+**
+** detector - detector structure
+** sg       - stallGuard2 value (10 bits)
+** stepRate - commanded speed while the reading was taken, full steps/s
+**
+** returns - 1 when the sample completed a window (power, dominant,
+**           frequency and resonant updated), 0 otherwise
+*/
+int tmc26xResonanceSample(TMC26XResonance* detector, uint16_t sg, uint16_t stepRate) {
+	int16_t x;
+	int32_t s;
+	uint8_t k;
+
+	// First window: take the first reading as the mean
+	if (detector->mean == 0xFFFF)
+		detector->mean = sg;
+
+	// Mean removed and quartered (+-255) so the bins stay within 32 bits
+	x = ((int16_t)sg - (int16_t)detector->mean) / 4;
+
+	for (k=0; k<TMC26X_RESONANCE_BINS; k++) {
+		s = x + ((tmc26xGoertzelCoefficients[k+1] * detector->s1[k]) >> 13) - detector->s2[k];
+		detector->s2[k] = detector->s1[k];
+		detector->s1[k] = s;
+	}
+
+	detector->sum += sg;
+	if (stepRate < detector->rateLow)
+		detector->rateLow = stepRate;
+	if (stepRate > detector->rateHigh)
+		detector->rateHigh = stepRate;
+
+	if (++detector->count < TMC26X_RESONANCE_WINDOW)
+		return 0;
+
+	tmc26xResonanceFinish(detector, stepRate);
+	return 1;
+}
+
+/* Moves a requested step rate out of the resonant bands, to the nearer band
+** edge. The motion layer accelerates through the band and cruises outside it.
+**
+** detector - detector structure
+** stepRate - requested speed, full steps/s
+**
+** returns - the speed to use
+*/
+uint16_t tmc26xResonanceSkip(TMC26XResonance* detector, uint16_t stepRate) {
+	TMC26XResonanceBand* band;
+	uint8_t i;
+
+	for (i=0; i<detector->bandCount; i++) {
+		band = &detector->bands[i];
+		if (stepRate > band->low && stepRate < band->high)
+			return (stepRate - band->low < band->high - stepRate) ? band->low : band->high;
+	}
+
+	return stepRate;
+}
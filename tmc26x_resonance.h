@@ -0,0 +1,50 @@
+// Resonance detector working on stallGuard2 readings. Each window of
+// TMC26X_RESONANCE_WINDOW samples runs through a fixed-point Goertzel bank
+// (bins 1 .. TMC26X_RESONANCE_BINS, bin k at k * sampleRate / 64 Hz) without
+// storing the samples. A window whose strongest bin stands out from the rest
+// marks the step rate it was taken at as resonant, and tmc26xResonanceSkip
+// then keeps the motion layer out of that band.
+#define TMC26X_RESONANCE_WINDOW 64
+
+// At most 31 (the bin below Nyquist)
+#ifndef TMC26X_RESONANCE_BINS
+#define TMC26X_RESONANCE_BINS 16
+#endif
+
+#ifndef TMC26X_RESONANCE_BANDS
+#define TMC26X_RESONANCE_BANDS 4
+#endif
+
+// Strongest bin must exceed this many times the average of the others
+#ifndef TMC26X_RESONANCE_RATIO
+#define TMC26X_RESONANCE_RATIO 8
+#endif
+
+typedef struct {
+	uint16_t low;       // step rates, full steps per second
+	uint16_t high;
+} TMC26XResonanceBand;
+
+typedef struct {
+	int32_t s1[TMC26X_RESONANCE_BINS];
+	int32_t s2[TMC26X_RESONANCE_BINS];
+	uint32_t power[TMC26X_RESONANCE_BINS];   // of the last window, bin k at [k-1]
+	uint32_t sum;                            // of the window being collected
+	uint16_t mean;                           // of the previous window
+	uint16_t sampleRate;                     // Hz
+	uint16_t minimumPower;                   // noise floor for a detection
+	uint16_t rateLow;                        // step rate range seen this window
+	uint16_t rateHigh;
+	uint8_t count;
+	uint8_t dominant;                        // strongest bin of the last window (k)
+	uint16_t frequency;                      // its frequency, Hz
+	uint8_t resonant;                        // last window showed a resonance
+	uint8_t bandWidth;                       // band marked, percent of the step rate
+	TMC26XResonanceBand bands[TMC26X_RESONANCE_BANDS];
+	uint8_t bandCount;
+} TMC26XResonance;
+
+
+void tmc26xResonanceInit(TMC26XResonance* detector, uint16_t sampleRate, uint16_t minimumPower, uint8_t bandWidth);
+int tmc26xResonanceSample(TMC26XResonance* detector, uint16_t sg, uint16_t stepRate);
+uint16_t tmc26xResonanceSkip(TMC26XResonance* detector, uint16_t stepRate);
@@ -0,0 +1,182 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_scrub.h"
+
+/* Initializes a scrubber for one driver. The scrubber only ever rewrites the
+** shadow registers held in config, so it can be attached at any time.
+**
+** scrubber - scrubber structure
+** config   - configuration structure of the driver to scrub
+*/
+void tmc26xScrubInit(TMC26XScrubber* scrubber, TMC26XConfiguration* config) {
+	scrubber->config = config;
+	scrubber->next = 0;
+	scrubber->resetCount = 0;
+}
+
+/* Checks a coolStep readback (SE in bits 14-10) against the committed
+** current scale. A driver that has browned out comes back with all registers
+** cleared (CS = 1/32), so the reported current scale no longer matches.
+**
+** config   - Configuration structure
+** response - 20-bit response produced with RDSEL = coolStep
+**
+** returns - 1 if SE is possible for the committed CS and SMARTEN, otherwise 0
+*/
+static int tmc26xScrubCoolStepConsistent(TMC26XConfiguration* config, uint32_t response) {
+	uint8_t reported, committed, minimum;
+
+	// SE in bits 14-10 of the response, CS in bits 0-4 of SGCSCONF
+	reported = (response >> 10) & 0x1F;
+	committed = config->regSGCSCONF & 0x1F;
+
+	// SEMIN (SMARTEN bits 0-3) of 0 disables coolStep, so SE must equal CS.
+	// Otherwise SE moves between CS/2 or CS/4 (SEIMIN, bit 15) and CS.
+	if ((config->regSMARTEN & 0x0F) == 0)
+		return reported == committed;
+
+	minimum = (config->regSMARTEN & ((uint32_t)1 << 15)) ? (committed + 1) / 4 : (committed + 1) / 2;
+	if (minimum > 0)
+		minimum--;
+
+	return reported >= minimum && reported <= committed;
+}
+
+/* Checks a 20-bit response against what the committed configuration says the
+** chip should be reporting. Only a coolStep readback carries redundant
+** information, other readback selections are always reported as consistent
+** (tmc26xScrubTick probes with coolStep itself, whatever RDSEL is committed).
+**
+** config   - Configuration structure (committed, i.e. DRVCONF/SGCSCONF clean)
+** response - 20-bit response as returned by tmc26xSendCommand
+**
+** returns - 1 if the response is plausible for the committed configuration,
+**           otherwise 0
+*/
+int tmc26xScrubResponseConsistent(TMC26XConfiguration* config, uint32_t response) {
+	if ((config->dirty & (TMC26X_DIRTY_BITMASK_DRVCONF | TMC26X_DIRTY_BITMASK_SGCSCONF))
+	 || tmc26xDRVCONFGetReadbackValue(config) != TMC26X_READBACK_COOLSTEP)
+		return 1;
+
+	return tmc26xScrubCoolStepConsistent(config, response);
+}
+
+/* Replays the complete shadow configuration to the chip. DRVCONF goes out
+** before SGCSCONF so that a reset chip (VSENSE = 305mV) never sees a current
+** scale that was committed against VSENSE = 165mV.
+**
+** config - Configuration structure
+**
+** returns - see tmc26xCommitConfiguration
+*/
+int tmc26xScrubRecover(TMC26XConfiguration* config) {
+	config->dirty = TMC26X_DIRTY_BITMASK_DRVCTRL | TMC26X_DIRTY_BITMASK_CHOPCONF | TMC26X_DIRTY_BITMASK_SMARTEN |
+	                TMC26X_DIRTY_BITMASK_SGCSCONF | TMC26X_DIRTY_BITMASK_DRVCONF;
+	return tmc26xCommitConfiguration(config, 0);
+}
+
+/* Rewrites DRVCONF and checks the chip for a reset, whatever RDSEL the
+** application uses: DRVCONF is sent with RDSEL = coolStep, then as
+** committed, so the second response shows the chip's current scale and the
+** chip is back on the committed RDSEL before any other frame. A current
+** scale that does not match means the chip has reset, and the full shadow is
+** replayed at once (five frames, DRVCONF first).
+**
+** scrubber - scrubber structure
+**
+** returns - TMC26X_SUCCESS if the chip checked out, TMC26X_CHIP_RESET if
+**           the configuration was replayed, TMC26X_EMERGENCY_STOP, or
+**           TMC26X_INVALID_CONFIG if the check is not possible because
+**           DRVCONF or SGCSCONF has uncommitted changes
+*/
+static int tmc26xScrubVerify(TMC26XScrubber* scrubber) {
+	TMC26XConfiguration* config = scrubber->config;
+	uint32_t response;
+	int result;
+
+	if (config->dirty & (TMC26X_DIRTY_BITMASK_DRVCONF | TMC26X_DIRTY_BITMASK_SGCSCONF))
+		return TMC26X_INVALID_CONFIG;
+
+	// RDSEL is bits 4-5, coolStep readback is 2
+	tmc26xSendCommand(config, (config->regDRVCONF & ~(uint32_t)0x30) | 0x20);
+	response = tmc26xSendCommand(config, config->regDRVCONF);
+	if (tmc26xEmergencyStopped)
+		return TMC26X_EMERGENCY_STOP;
+
+	if (!tmc26xScrubCoolStepConsistent(config, response)) {
+		scrubber->resetCount++;
+		if ((result = tmc26xScrubRecover(config)) != TMC26X_SUCCESS)
+			return result;
+		return TMC26X_CHIP_RESET;
+	}
+
+	return TMC26X_SUCCESS;
+}
+
+/* Rewrites a single shadow register, from a periodic tick, and detects chip
+** resets (see tmc26xScrubVerify). SGCSCONF and CHOPCONF, the registers that
+** set the current and turn the bridges on, are only rewritten right after a
+** DRVCONF check in the same tick, so a chip that reset with VSENSE = 305mV
+** never gets a current scale committed against 165mV. A round of five ticks
+** costs 2 + 3 + 1 + 3 + 1 frames. Registers with uncommitted changes are
+** skipped, those are left for tmc26xCommitConfiguration to write in its safe
+** order.
+**
+** scrubber - scrubber structure
+**
+** returns - TMC26X_SUCCESS, TMC26X_CHIP_RESET if a reset was detected and the
+**           configuration replayed, or TMC26X_INVALID_CONFIG if the
+**           configuration is incomplete
+*/
+int tmc26xScrubTick(TMC26XScrubber* scrubber) {
+	TMC26XConfiguration* config = scrubber->config;
+	uint32_t reg;
+	uint8_t dirtyBit, step;
+	int result;
+
+	if (config->validity != 0xFFFFFFFF)
+		return TMC26X_INVALID_CONFIG;
+
+	step = scrubber->next;
+	scrubber->next = (scrubber->next + 1) % 5;
+
+	// Same order as tmc26xCommitConfiguration
+	switch (step) {
+	case 0:
+		result = tmc26xScrubVerify(scrubber);
+		return result == TMC26X_CHIP_RESET ? result : TMC26X_SUCCESS;
+	case 1:
+		reg = config->regSGCSCONF;
+		dirtyBit = TMC26X_DIRTY_BITMASK_SGCSCONF;
+		break;
+	case 2:
+		reg = config->regDRVCTRL;
+		dirtyBit = TMC26X_DIRTY_BITMASK_DRVCTRL;
+		break;
+	case 3:
+		reg = config->regCHOPCONF;
+		dirtyBit = TMC26X_DIRTY_BITMASK_CHOPCONF;
+		break;
+	default:
+		reg = config->regSMARTEN;
+		dirtyBit = TMC26X_DIRTY_BITMASK_SMARTEN;
+		break;
+	}
+
+	if (config->dirty & dirtyBit)
+		return TMC26X_SUCCESS;
+
+	if (step == 1 || step == 3) {
+		result = tmc26xScrubVerify(scrubber);
+		// A replay has written everything already
+		if (result == TMC26X_CHIP_RESET)
+			return result;
+		if (result != TMC26X_SUCCESS)
+			return TMC26X_SUCCESS;
+	}
+
+	tmc26xSendCommand(config, reg);
+
+	return TMC26X_SUCCESS;
+}
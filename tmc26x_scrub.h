@@ -0,0 +1,12 @@
+// Structure for the background register scrubber
+typedef struct {
+	TMC26XConfiguration* config;
+	uint8_t next;
+	uint16_t resetCount;
+} TMC26XScrubber;
+
+
+void tmc26xScrubInit(TMC26XScrubber* scrubber, TMC26XConfiguration* config);
+int tmc26xScrubTick(TMC26XScrubber* scrubber);
+int tmc26xScrubResponseConsistent(TMC26XConfiguration* config, uint32_t response);
+int tmc26xScrubRecover(TMC26XConfiguration* config);
@@ -0,0 +1,62 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_bulk.h"
+#include "tmc26x_steptrack.h"
+#include "tmc26x_sgsync.h"
+
+/* Sets up synchronized sampling for the axis of a step tracker, which lines
+** the full steps up with the chip. RDSEL is left on stallGuard2 so every later
+** read is a single frame. Initialize again after changing SFILT.
+**
+** sync    - sampler structure
+** tracker - step tracker of the axis, fed by the step ISR
+**
+** returns - TMC26X_SUCCESS or TMC26X_INVALID_CONFIG
+*/
+int tmc26xSGSyncInit(TMC26XSGSync* sync, TMC26XStepTracker* tracker) {
+	TMC26XConfiguration* config = tracker->config;
+
+	if (config->validity != 0xFFFFFFFF)
+		return TMC26X_INVALID_CONFIG;
+
+	sync->tracker = tracker;
+	sync->filtered = tmc26xFieldGetRaw(config, TMC26X_FIELD_SGCSCONF_STALLGUARD_FILTER) ? 1 : 0;
+	sync->seen = sync->filtered ? tracker->cycles : tracker->fullSteps;
+	sync->sample.sg = tmc26xReadStallGuardValue(config);
+	sync->sample.stale = 1;
+	sync->sample.missed = 0;
+
+	return TMC26X_SUCCESS;
+}
+
+/* Takes a sample: reads the chip if it has measured since the last read,
+** otherwise returns the last value without touching the bus.
+**
+** sync   - sampler structure
+** sample - receives the value and its flags
+**
+** returns - 1 if a frame was sent (fresh value), 0 if stale
+*/
+int tmc26xSGSyncPoll(TMC26XSGSync* sync, TMC26XSGSample* sample) {
+	uint8_t count, due;
+
+	// A single byte, read in one go while the step ISR counts on
+	count = sync->filtered ? sync->tracker->cycles : sync->tracker->fullSteps;
+	due = count - sync->seen;
+	sync->seen = count;
+
+	if (!due) {
+		sync->sample.stale = 1;
+		sync->sample.missed = 0;
+		*sample = sync->sample;
+		return 0;
+	}
+
+	sync->sample.sg = tmc26xReadStallGuardValue(sync->tracker->config);
+	sync->sample.stale = 0;
+	sync->sample.missed = due - 1;
+	*sample = sync->sample;
+
+	return 1;
+}
@@ -0,0 +1,24 @@
+// A stallGuard2 reading with its freshness
+typedef struct {
+	uint16_t sg;
+	uint8_t stale;     // 1 if the chip has not measured since the last read
+	uint8_t missed;    // measurements the last read came too late for
+} TMC26XSGSample;
+
+// Schedules stallGuard2 reads from the step tracker. The chip measures SG
+// once per full step, or once per four with the SG filter (SFILT) on, so a
+// read is only due after the STEP pulses have carried the sine table across
+// that many full steps (filtered, across table position 128). tmc26xSGSyncPoll
+// sends a frame only when a new value is there to read, otherwise it hands
+// back the last one marked stale. It must run at least once every 255 full
+// steps.
+typedef struct {
+	TMC26XStepTracker* tracker;
+	uint8_t filtered;        // 1 with SFILT, counts electrical cycles
+	uint8_t seen;            // tracker count at the last read
+	TMC26XSGSample sample;
+} TMC26XSGSync;
+
+
+int tmc26xSGSyncInit(TMC26XSGSync* sync, TMC26XStepTracker* tracker);
+int tmc26xSGSyncPoll(TMC26XSGSync* sync, TMC26XSGSample* sample);
@@ -0,0 +1,143 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_stats.h"
+#include "tmc26x_arch.h"
+
+/* Empties the statistics of one quantity
+**
+** stats     - statistics structure
+** ewmaShift - exponential average over about 2^ewmaShift samples (0 .. 8)
+*/
+void tmc26xStatsReset(TMC26XStats* stats, uint8_t ewmaShift) {
+	stats->minHead = 0;
+	stats->minCount = 0;
+	stats->maxHead = 0;
+	stats->maxCount = 0;
+	stats->next = 0;
+	stats->filled = 0;
+	stats->sum = 0;
+	stats->sumSquares = 0;
+	stats->ewma = 0;
+	stats->ewmaShift = ewmaShift > 8 ? 8 : ewmaShift;
+	stats->last = 0;
+	stats->count = 0;
+}
+
+/* Adds a sample. Each sample enters and leaves each deque once, so the
+** update is constant time amortized, and never worse than the window.
+**
+** stats - statistics structure
+** value - sample
+*/
+void tmc26xStatsAdd(TMC26XStats* stats, uint16_t value) {
+	uint8_t n = stats->next;
+	uint8_t slot = n & (TMC26X_STATS_WINDOW - 1);
+
+	// Retire the sample this one replaces
+	if (stats->filled == TMC26X_STATS_WINDOW) {
+		stats->sum -= stats->ring[slot];
+		stats->sumSquares -= (uint32_t)stats->ring[slot] * stats->ring[slot];
+		if (stats->minCount && stats->minQueue[stats->minHead] == (uint8_t)(n - TMC26X_STATS_WINDOW)) {
+			stats->minHead = (stats->minHead + 1) & (TMC26X_STATS_WINDOW - 1);
+			stats->minCount--;
+		}
+		if (stats->maxCount && stats->maxQueue[stats->maxHead] == (uint8_t)(n - TMC26X_STATS_WINDOW)) {
+			stats->maxHead = (stats->maxHead + 1) & (TMC26X_STATS_WINDOW - 1);
+			stats->maxCount--;
+		}
+	} else {
+		stats->filled++;
+	}
+
+	// Samples that can no longer be the minimum (maximum) leave from the back
+	while (stats->minCount && stats->ring[stats->minQueue[(stats->minHead + stats->minCount - 1) & (TMC26X_STATS_WINDOW - 1)] & (TMC26X_STATS_WINDOW - 1)] >= value)
+		stats->minCount--;
+	while (stats->maxCount && stats->ring[stats->maxQueue[(stats->maxHead + stats->maxCount - 1) & (TMC26X_STATS_WINDOW - 1)] & (TMC26X_STATS_WINDOW - 1)] <= value)
+		stats->maxCount--;
+
+	stats->ring[slot] = value;
+	stats->minQueue[(stats->minHead + stats->minCount++) & (TMC26X_STATS_WINDOW - 1)] = n;
+	stats->maxQueue[(stats->maxHead + stats->maxCount++) & (TMC26X_STATS_WINDOW - 1)] = n;
+
+	stats->sum += value;
+	stats->sumSquares += (uint32_t)value * value;
+
+	if (stats->count)
+		stats->ewma += (int32_t)(((uint32_t)value << 8) - stats->ewma) >> stats->ewmaShift;
+	else
+		stats->ewma = (uint32_t)value << 8;
+
+	stats->last = value;
+	stats->count++;
+	stats->next = n + 1;
+}
+
+/* Copies out the current statistics. Interrupts are held off for the copy
+** only, so the readback path can keep feeding from an interrupt.
+**
+** stats    - statistics structure
+** snapshot - filled in; all zero before the first sample
+*/
+void tmc26xStatsSnapshot(const TMC26XStats* stats, TMC26XStatsSnapshot* snapshot) {
+	uint32_t sum, sumSquares;
+	uint16_t n;
+	tmc26xCriticalBegin();
+
+	n = stats->filled;
+	sum = stats->sum;
+	sumSquares = stats->sumSquares;
+	snapshot->last = stats->last;
+	snapshot->min = n ? stats->ring[stats->minQueue[stats->minHead] & (TMC26X_STATS_WINDOW - 1)] : 0;
+	snapshot->max = n ? stats->ring[stats->maxQueue[stats->maxHead] & (TMC26X_STATS_WINDOW - 1)] : 0;
+	snapshot->ewma = (stats->ewma + 8) >> 4;
+	snapshot->count = stats->count;
+
+	tmc26xCriticalEnd();
+
+	snapshot->samples = n;
+	if (!n) {
+		snapshot->mean = 0;
+		snapshot->variance = 0;
+		return;
+	}
+
+	// Population variance (n * sumSquares - sum^2) / n^2, exact in integers
+	snapshot->mean = ((sum << 4) + n / 2) / n;
+	snapshot->variance = (((uint64_t)sumSquares * n - (uint64_t)sum * sum) << 4) / ((uint32_t)n * n);
+}
+
+/* Empties the statistics of every quantity of an axis
+**
+** stats     - per axis statistics
+** ewmaShift - see tmc26xStatsReset
+*/
+void tmc26xAxisStatsReset(TMC26XAxisStats* stats, uint8_t ewmaShift) {
+	uint8_t i;
+
+	for (i=0; i<TMC26X_STATS_QUANTITIES; i++)
+		tmc26xStatsReset(&stats->quantity[i], ewmaShift);
+}
+
+/* Feeds a readback response straight in, whatever path read it (helpers,
+** queued reads, telemetry, poller).
+**
+** stats    - per axis statistics
+** readback - RDSEL the response was produced with (TMC26X_READBACK_...)
+** response - 20-bit response (tmc26xReadRaw)
+*/
+void tmc26xAxisStatsResponse(TMC26XAxisStats* stats, uint8_t readback, uint32_t response) {
+	uint16_t value = (response >> 10) & 0x3FF;
+
+	switch (readback) {
+	case TMC26X_READBACK_MICROSTEP:
+		tmc26xStatsAdd(&stats->quantity[TMC26X_STATS_MSTEP], value);
+		break;
+	case TMC26X_READBACK_STALLGUARD:
+		tmc26xStatsAdd(&stats->quantity[TMC26X_STATS_SG], value);
+		break;
+	case TMC26X_READBACK_COOLSTEP:
+		tmc26xStatsAdd(&stats->quantity[TMC26X_STATS_SE], value & 0x1F);
+		break;
+	}
+}
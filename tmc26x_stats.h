@@ -0,0 +1,58 @@
+// Samples kept for the windowed statistics, a power of two up to 128
+#ifndef TMC26X_STATS_WINDOW
+#define TMC26X_STATS_WINDOW 32
+#endif
+
+// Readback quantities tracked per axis
+enum {
+	TMC26X_STATS_SG = 0,
+	TMC26X_STATS_SE,
+	TMC26X_STATS_MSTEP,
+	TMC26X_STATS_QUANTITIES
+};
+
+// Rolling statistics of one quantity, constant memory and constant time per
+// sample (amortized for min/max). The last TMC26X_STATS_WINDOW samples give
+// min and max, through monotonic deques of ring positions, and the mean and
+// variance, through running integer sums that are exact so nothing drifts.
+// An exponential average covers the longer term. MSTEP is taken as the raw
+// table position, its statistics only make sense while the axis holds still
+// or moves within a quarter turn of the table.
+typedef struct {
+	uint16_t ring[TMC26X_STATS_WINDOW];
+	uint8_t minQueue[TMC26X_STATS_WINDOW];   // sample numbers, increasing values
+	uint8_t maxQueue[TMC26X_STATS_WINDOW];   // sample numbers, decreasing values
+	uint8_t minHead, minCount;
+	uint8_t maxHead, maxCount;
+	uint8_t next;            // sample number of the next sample, modulo 256
+	uint8_t filled;
+	uint32_t sum;
+	uint32_t sumSquares;
+	uint32_t ewma;           // << 8
+	uint8_t ewmaShift;       // average over about 2^ewmaShift samples
+	uint16_t last;
+	uint32_t count;
+} TMC26XStats;
+
+typedef struct {
+	TMC26XStats quantity[TMC26X_STATS_QUANTITIES];
+} TMC26XAxisStats;
+
+// Values derived from the window when the snapshot was taken
+typedef struct {
+	uint16_t last;
+	uint16_t min;
+	uint16_t max;
+	uint16_t mean;           // << 4
+	uint32_t variance;       // << 4
+	uint16_t ewma;           // << 4
+	uint8_t samples;         // in the window
+	uint32_t count;          // since reset
+} TMC26XStatsSnapshot;
+
+
+void tmc26xStatsReset(TMC26XStats* stats, uint8_t ewmaShift);
+void tmc26xStatsAdd(TMC26XStats* stats, uint16_t value);
+void tmc26xStatsSnapshot(const TMC26XStats* stats, TMC26XStatsSnapshot* snapshot);
+void tmc26xAxisStatsReset(TMC26XAxisStats* stats, uint8_t ewmaShift);
+void tmc26xAxisStatsResponse(TMC26XAxisStats* stats, uint8_t readback, uint32_t response);
@@ -0,0 +1,88 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_bulk.h"
+#include "tmc26x_steptrack.h"
+#include "tmc26x_steploss.h"
+
+/* Sets up a detector on the axis of a step tracker, whose reference is the
+** chip's position when the tracker was initialized. The axis must not use
+** STEP interpolation: with INTPOL the chip walks through the 256 microstep
+** positions between pulses, so a readback can land anywhere between two
+** counted steps.
+**
+** detector - detector structure
+** tracker  - step tracker of the axis, fed by the step ISR
+** interval - tmc26xStepLossPoll calls per readback, i.e. the sample rate is
+**            the poll rate / interval
+** correct  - called on a slip, or 0
+**
+** returns - TMC26X_SUCCESS, TMC26X_INVALID_MODE or TMC26X_INVALID_CONFIG
+*/
+int tmc26xStepLossInit(TMC26XStepLoss* detector, TMC26XStepTracker* tracker, uint16_t interval, TMC26XStepLossCallback correct) {
+	TMC26XConfiguration* config = tracker->config;
+
+	if (config->validity != 0xFFFFFFFF)
+		return TMC26X_INVALID_CONFIG;
+	if (tmc26xFieldGetRaw(config, TMC26X_FIELD_DRVCTRL_STEP_INTERPOLATION))
+		return TMC26X_INVALID_MODE;
+
+	detector->tracker = tracker;
+	detector->correct = correct;
+	detector->tolerance = 0;
+	detector->interval = interval ? interval : 1;
+	detector->countdown = detector->interval;
+	detector->slip = 0;
+	detector->events = 0;
+
+	return TMC26X_SUCCESS;
+}
+
+/* Compares a microstep readback, taken by any means (helper, queued read,
+** telemetry), with the steps counted. The difference is rounded to whole
+** steps; less than half a step is not a slip.
+**
+** detector - detector structure
+** mstep    - 10-bit MSTEP readback
+**
+** returns - TMC26X_SUCCESS or TMC26X_STEP_LOSS
+*/
+int tmc26xStepLossCheck(TMC26XStepLoss* detector, uint16_t mstep) {
+	int16_t difference = (mstep - tmc26xStepTrackerPosition(detector->tracker)) & 0x3FF;
+	int16_t increment = detector->tracker->increment;
+
+	// Nearest way round the table
+	if (difference >= 512)
+		difference -= 1024;
+
+	detector->slip = (difference >= 0 ? difference + increment / 2 : difference - increment / 2) / increment;
+	if (!detector->slip || (difference <= (int16_t)detector->tolerance && difference >= -(int16_t)detector->tolerance)) {
+		detector->slip = 0;
+		return TMC26X_SUCCESS;
+	}
+
+	detector->events++;
+	if (detector->correct && detector->correct(detector->tracker->config, detector->slip))
+		tmc26xStepTrackerReference(detector->tracker, mstep);
+
+	return TMC26X_STEP_LOSS;
+}
+
+/* Call at a fixed rate; every interval calls it reads MSTEP (one SPI frame
+** when microstep readback is already selected) and checks it. Call it with
+** stepping held off, or from a context the step ISR does not interrupt
+** between the readback and the check, so the count and the readback agree.
+** Otherwise set detector->tolerance to the increment to allow for one pulse in
+** flight (at the cost of not seeing single step slips).
+**
+** detector - detector structure
+**
+** returns - TMC26X_SUCCESS or TMC26X_STEP_LOSS
+*/
+int tmc26xStepLossPoll(TMC26XStepLoss* detector) {
+	if (--detector->countdown)
+		return TMC26X_SUCCESS;
+	detector->countdown = detector->interval;
+
+	return tmc26xStepLossCheck(detector, tmc26xReadMicroStepValue(detector->tracker->config));
+}
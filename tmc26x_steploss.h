@@ -0,0 +1,27 @@
+// Called when a slip is detected with the difference in steps (chip ahead of
+// the commanded position is positive). Return 1 after correcting the step
+// count (e.g. by adjusting the planner's position) to accept the chip's
+// position as the new reference, 0 to keep flagging until it is resolved.
+typedef int (*TMC26XStepLossCallback)(TMC26XConfiguration* config, int16_t steps);
+
+// Compares the sine table position a step tracker counted from the STEP
+// pulses with the chip's MSTEP counter. A difference means STEP pulses were
+// lost or added on the way to the chip, or the chip reset and restarted its
+// table; slips of a whole electrical cycle (4 full steps) cannot be seen.
+// Axes with STEP interpolation cannot be checked. A motor that stalls while
+// the chip keeps counting does not show here, that is what stallGuard2 is
+// for.
+typedef struct {
+	TMC26XStepTracker* tracker;
+	TMC26XStepLossCallback correct;
+	uint16_t tolerance;      // table positions accepted, 0 unless a pulse can be in flight
+	uint16_t interval;       // polls per readback
+	uint16_t countdown;
+	int16_t slip;            // last difference seen, in steps
+	uint16_t events;
+} TMC26XStepLoss;
+
+
+int tmc26xStepLossInit(TMC26XStepLoss* detector, TMC26XStepTracker* tracker, uint16_t interval, TMC26XStepLossCallback correct);
+int tmc26xStepLossCheck(TMC26XStepLoss* detector, uint16_t mstep);
+int tmc26xStepLossPoll(TMC26XStepLoss* detector);
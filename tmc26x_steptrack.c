@@ -0,0 +1,67 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_bulk.h"
+#include "tmc26x_steptrack.h"
+#include "tmc26x_arch.h"
+
+/* Sets up a tracker and takes the chip's present position as the reference.
+** The axis must be committed in step/dir mode; if MRES changes the tracker,
+** and the modules using it, have to be initialized again.
+**
+** tracker - tracker structure
+** config  - Configuration structure of the axis
+**
+** returns - TMC26X_SUCCESS, TMC26X_INVALID_MODE or TMC26X_INVALID_CONFIG
+*/
+int tmc26xStepTrackerInit(TMC26XStepTracker* tracker, TMC26XConfiguration* config) {
+	uint8_t mres;
+
+	if (config->validity != 0xFFFFFFFF)
+		return TMC26X_INVALID_CONFIG;
+	if (config->regDRVCONF & TMC26X_DRVCONF_DRIVEMODE_BITMASK)
+		return TMC26X_INVALID_MODE;
+
+	mres = tmc26xFieldGetRaw(config, TMC26X_FIELD_DRVCTRL_MICROSTEP_RESOLUTION);
+	if (mres > 8)
+		mres = 8;
+
+	tracker->config = config;
+	tracker->increment = 1 << mres;
+	tracker->fullSteps = 0;
+	tracker->cycles = 0;
+	tracker->position = tmc26xReadMicroStepValue(config);
+
+	return TMC26X_SUCCESS;
+}
+
+/* Returns the position counted so far, read in one piece while the step ISR
+** may be updating it
+**
+** tracker - tracker structure
+**
+** returns - sine table position, 0 .. 1023
+*/
+uint16_t tmc26xStepTrackerPosition(TMC26XStepTracker* tracker) {
+	uint16_t position;
+	tmc26xCriticalBegin();
+
+	position = tracker->position;
+
+	tmc26xCriticalEnd();
+	return position;
+}
+
+/* Takes a position read back from the chip as the new reference, e.g. once a
+** slip has been corrected for
+**
+** tracker  - tracker structure
+** position - sine table position, 0 .. 1023
+*/
+void tmc26xStepTrackerReference(TMC26XStepTracker* tracker, uint16_t position) {
+	tmc26xCriticalBegin();
+
+	tracker->position = position & 0x3FF;
+
+	tmc26xCriticalEnd();
+}
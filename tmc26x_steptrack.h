@@ -0,0 +1,46 @@
+// Full steps are the sine table positions 128 + 256 * n, where both coils
+// carry the same current (the entries full step mode, MRES = 8, runs on)
+enum {
+	TMC26X_FULL_STEP_PHASE = 128
+};
+
+// Follows the chip's sine table position from the STEP pulses sent to a
+// step/dir axis, for the modules that need it between readbacks (step-loss
+// detection, stallGuard2 synchronized sampling). The step ISR calls
+// tmc26xStepTrackerStep once per pulse; the full step and electrical cycle
+// counters run freely and wrap, their readers keep the last value they saw.
+typedef struct {
+	TMC26XConfiguration* config;
+	volatile uint16_t position;  // sine table position the chip should be at, 0 .. 1023
+	uint16_t increment;          // table positions per STEP pulse (2^MRES)
+	volatile uint8_t fullSteps;  // full step positions reached
+	volatile uint8_t cycles;     // electrical cycles, i.e. table position 128 reached
+} TMC26XStepTracker;
+
+
+int tmc26xStepTrackerInit(TMC26XStepTracker* tracker, TMC26XConfiguration* config);
+uint16_t tmc26xStepTrackerPosition(TMC26XStepTracker* tracker);
+void tmc26xStepTrackerReference(TMC26XStepTracker* tracker, uint16_t position);
+
+// Called for every STEP pulse issued, direction 1 or -1. Kept inline for the
+// step ISR. A full step counts when the table reaches it in either direction:
+// a pulse covers the positions above the old one up to the new one going up,
+// and the new one up to below the old one going down; ahead is the offset of
+// the next full step into that range.
+static inline void tmc26xStepTrackerStep(TMC26XStepTracker* tracker, int8_t direction) {
+	uint16_t ahead;
+
+	if (direction < 0) {
+		tracker->position = (tracker->position - tracker->increment) & 0x3FF;
+		ahead = TMC26X_FULL_STEP_PHASE - tracker->position;
+	} else {
+		ahead = TMC26X_FULL_STEP_PHASE - 1 - tracker->position;
+		tracker->position = (tracker->position + tracker->increment) & 0x3FF;
+	}
+
+	if ((ahead & 0xFF) < tracker->increment) {
+		tracker->fullSteps++;
+		if ((ahead & 0x3FF) < tracker->increment)
+			tracker->cycles++;
+	}
+}
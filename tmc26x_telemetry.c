@@ -0,0 +1,316 @@
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_blob.h"
+#include "tmc26x_telemetry.h"
+
+/* Fills a telemetry sample from a raw response. Fields the readback does not
+** carry are left as they were (and their valid bits untouched), so a sample
+** can collect a microstep, a stallGuard and a coolStep readback in turn.
+**
+** sample   - sample to update
+** readback - TMC26X_READBACK_... the response was read with
+** response - 20-bit response (tmc26xReadRaw)
+*/
+void tmc26xTelemetrySampleResponse(TMC26XTelemetrySample* sample, uint8_t readback, uint32_t response) {
+	uint16_t value = (response >> 10) & 0x3FF;
+
+	switch (readback) {
+	case TMC26X_READBACK_MICROSTEP:
+		sample->mstep = value;
+		sample->valid |= TMC26X_TELEMETRY_MSTEP;
+		break;
+	case TMC26X_READBACK_STALLGUARD:
+		sample->sg = value;
+		sample->valid |= TMC26X_TELEMETRY_SG;
+		break;
+	case TMC26X_READBACK_COOLSTEP:
+		sample->se = value & 0x1F;
+		sample->valid |= TMC26X_TELEMETRY_SE;
+		break;
+	}
+	sample->status = response & 0xFF;
+	sample->valid |= TMC26X_TELEMETRY_STATUS;
+}
+
+/* Takes one readback with the committed RDSEL (no extra DRVCONF write) into
+** a telemetry sample. The readback frame rewrites DRVCONF, so nothing is sent
+** while DRVCONF or SGCSCONF has uncommitted changes: that would bypass the
+** safe order of tmc26xCommitConfiguration and decode with an RDSEL the chip
+** does not have yet.
+**
+** config - Current configuration structure
+** sample - sample to update
+**
+** returns - TMC26X_SUCCESS or TMC26X_INVALID_CONFIG if RDSEL was never set or
+**           DRVCONF/SGCSCONF are dirty
+*/
+int tmc26xReadTelemetry(TMC26XConfiguration* config, TMC26XTelemetrySample* sample) {
+	int8_t readback = tmc26xDRVCONFGetReadbackValue(config);
+
+	if (readback < 0 || (config->dirty & (TMC26X_DIRTY_BITMASK_DRVCONF | TMC26X_DIRTY_BITMASK_SGCSCONF)))
+		return TMC26X_INVALID_CONFIG;
+
+	tmc26xTelemetrySampleResponse(sample, readback, tmc26xReadRaw(config));
+	return TMC26X_SUCCESS;
+}
+
+/* Starts a stream, the first frame is a keyframe
+**
+** encoder - encoder structure
+** axes    - axes per frame, at most TMC26X_TELEMETRY_MAX_AXES
+*/
+void tmc26xTelemetryEncoderInit(TMC26XTelemetryEncoder* encoder, uint8_t axes) {
+	uint8_t i;
+
+	if (axes > TMC26X_TELEMETRY_MAX_AXES)
+		axes = TMC26X_TELEMETRY_MAX_AXES;
+
+	for (i=0; i<TMC26X_TELEMETRY_MAX_AXES; i++) {
+		encoder->last[i].sg = 0;
+		encoder->last[i].mstep = 0;
+		encoder->last[i].se = 0;
+		encoder->last[i].status = 0;
+		encoder->last[i].valid = 0;
+	}
+	encoder->axes = axes;
+	encoder->sequence = 0;
+	encoder->sinceKeyframe = TMC26X_TELEMETRY_KEYFRAME_INTERVAL;
+}
+
+/* Encodes one tick. Values equal to the last ones sent are left out, SG and
+** MSTEP changes are sent as one byte deltas where they fit.
+**
+** encoder - encoder structure
+** samples - one sample per axis
+** out     - buffer of at least TMC26X_TELEMETRY_MAX_FRAME bytes
+**
+** returns - frame length in bytes
+*/
+uint16_t tmc26xTelemetryEncode(TMC26XTelemetryEncoder* encoder, const TMC26XTelemetrySample* samples, uint8_t* out) {
+	TMC26XTelemetrySample* last;
+	const TMC26XTelemetrySample* sample;
+	uint8_t keyframe = encoder->sinceKeyframe >= TMC26X_TELEMETRY_KEYFRAME_INTERVAL;
+	uint16_t i = 5, header, crc = 0xFFFF, j;
+	uint8_t axis, have;
+	int16_t delta;
+
+	out[0] = TMC26X_TELEMETRY_SYNC;
+	out[2] = encoder->sequence++;
+	out[3] = keyframe ? TMC26X_TELEMETRY_KEYFRAME : 0;
+	out[4] = encoder->axes;
+
+	for (axis=0; axis<encoder->axes; axis++) {
+		sample = &samples[axis];
+		last = &encoder->last[axis];
+		header = i++;
+		out[header] = 0;
+
+		// Known to the receiver after this frame
+		have = last->valid | sample->valid;
+
+		if (sample->valid & TMC26X_TELEMETRY_SG) {
+			delta = sample->sg - last->sg;
+			if (keyframe || !(last->valid & TMC26X_TELEMETRY_SG) || delta < -128 || delta > 127) {
+				out[header] |= TMC26X_TELEMETRY_SG;
+				out[i++] = sample->sg >> 8;
+				out[i++] = sample->sg;
+			} else if (delta) {
+				out[header] |= TMC26X_TELEMETRY_SG | TMC26X_TELEMETRY_SG_DELTA;
+				out[i++] = (uint8_t)delta;
+			}
+			last->sg = sample->sg;
+		} else if (keyframe && (last->valid & TMC26X_TELEMETRY_SG)) {
+			out[header] |= TMC26X_TELEMETRY_SG;
+			out[i++] = last->sg >> 8;
+			out[i++] = last->sg;
+		}
+
+		if (sample->valid & TMC26X_TELEMETRY_MSTEP) {
+			// Shortest way round the sine table
+			delta = (sample->mstep - last->mstep) & 0x3FF;
+			if (delta >= 512)
+				delta -= 1024;
+			if (keyframe || !(last->valid & TMC26X_TELEMETRY_MSTEP) || delta < -128 || delta > 127) {
+				out[header] |= TMC26X_TELEMETRY_MSTEP;
+				out[i++] = sample->mstep >> 8;
+				out[i++] = sample->mstep;
+			} else if (delta) {
+				out[header] |= TMC26X_TELEMETRY_MSTEP | TMC26X_TELEMETRY_MSTEP_DELTA;
+				out[i++] = (uint8_t)delta;
+			}
+			last->mstep = sample->mstep;
+		} else if (keyframe && (last->valid & TMC26X_TELEMETRY_MSTEP)) {
+			out[header] |= TMC26X_TELEMETRY_MSTEP;
+			out[i++] = last->mstep >> 8;
+			out[i++] = last->mstep;
+		}
+
+		if (sample->valid & TMC26X_TELEMETRY_SE) {
+			if (keyframe || !(last->valid & TMC26X_TELEMETRY_SE) || sample->se != last->se) {
+				out[header] |= TMC26X_TELEMETRY_SE;
+				out[i++] = sample->se;
+			}
+			last->se = sample->se;
+		} else if (keyframe && (last->valid & TMC26X_TELEMETRY_SE)) {
+			out[header] |= TMC26X_TELEMETRY_SE;
+			out[i++] = last->se;
+		}
+
+		if (sample->valid & TMC26X_TELEMETRY_STATUS) {
+			if (keyframe || !(last->valid & TMC26X_TELEMETRY_STATUS) || sample->status != last->status) {
+				out[header] |= TMC26X_TELEMETRY_STATUS;
+				out[i++] = sample->status;
+			}
+			last->status = sample->status;
+		} else if (keyframe && (last->valid & TMC26X_TELEMETRY_STATUS)) {
+			out[header] |= TMC26X_TELEMETRY_STATUS;
+			out[i++] = last->status;
+		}
+
+		last->valid = have;
+	}
+
+	out[1] = i - 2;
+	for (j=1; j<i; j++)
+		crc = tmc26xBlobCRC16(crc, out[j]);
+	out[i++] = crc;
+	out[i++] = crc >> 8;
+
+	encoder->sinceKeyframe = keyframe ? 1 : encoder->sinceKeyframe + 1;
+
+	return i;
+}
+
+/* Prepares a decoder, it waits for the first keyframe
+**
+** decoder - decoder structure
+*/
+void tmc26xTelemetryDecoderInit(TMC26XTelemetryDecoder* decoder) {
+	uint8_t i;
+
+	for (i=0; i<TMC26X_TELEMETRY_MAX_AXES; i++)
+		decoder->axis[i].valid = 0;
+	decoder->axes = 0;
+	decoder->sequence = 0;
+	decoder->synced = 0;
+	decoder->lost = 0;
+	decoder->fill = 0;
+}
+
+// Drops the first buffered byte and skips to the next sync byte
+static void tmc26xTelemetryResync(TMC26XTelemetryDecoder* decoder) {
+	uint16_t from = 1, i;
+
+	while (from < decoder->fill && decoder->buffer[from] != TMC26X_TELEMETRY_SYNC)
+		from++;
+	for (i=from; i<decoder->fill; i++)
+		decoder->buffer[i - from] = decoder->buffer[i];
+	decoder->fill -= from;
+}
+
+// Applies the records of a frame that passed its CRC check
+static int tmc26xTelemetryApply(TMC26XTelemetryDecoder* decoder) {
+	const uint8_t* frame = decoder->buffer;
+	uint16_t end = frame[1] + 2, i = 5;
+	TMC26XTelemetrySample* sample;
+	uint8_t axis, header;
+
+	if (decoder->synced && frame[2] != (uint8_t)(decoder->sequence + 1)) {
+		decoder->lost += (uint8_t)(frame[2] - decoder->sequence - 1);
+		decoder->synced = 0;
+	}
+	decoder->sequence = frame[2];
+	if (frame[3] & TMC26X_TELEMETRY_KEYFRAME)
+		decoder->synced = 1;
+	// Deltas are meaningless until a keyframe has been seen
+	if (!decoder->synced || frame[4] > TMC26X_TELEMETRY_MAX_AXES)
+		return 0;
+
+	for (axis=0; axis<frame[4]; axis++) {
+		sample = &decoder->axis[axis];
+		if (i >= end)
+			break;
+		header = frame[i++];
+
+		if (header & TMC26X_TELEMETRY_SG) {
+			if (header & TMC26X_TELEMETRY_SG_DELTA)
+				sample->sg += (int8_t)frame[i++];
+			else {
+				sample->sg = (uint16_t)frame[i] << 8 | frame[i+1];
+				i += 2;
+			}
+			sample->valid |= TMC26X_TELEMETRY_SG;
+		}
+		if (header & TMC26X_TELEMETRY_MSTEP) {
+			if (header & TMC26X_TELEMETRY_MSTEP_DELTA)
+				sample->mstep = (sample->mstep + (int8_t)frame[i++]) & 0x3FF;
+			else {
+				sample->mstep = (uint16_t)frame[i] << 8 | frame[i+1];
+				i += 2;
+			}
+			sample->valid |= TMC26X_TELEMETRY_MSTEP;
+		}
+		if (header & TMC26X_TELEMETRY_SE) {
+			sample->se = frame[i++];
+			sample->valid |= TMC26X_TELEMETRY_SE;
+		}
+		if (header & TMC26X_TELEMETRY_STATUS) {
+			sample->status = frame[i++];
+			sample->valid |= TMC26X_TELEMETRY_STATUS;
+		}
+	}
+
+	// A frame that passes the CRC but does not parse came from a broken encoder
+	if (axis != frame[4] || i != end) {
+		decoder->synced = 0;
+		decoder->lost++;
+		return 0;
+	}
+
+	decoder->axes = frame[4];
+	return 1;
+}
+
+/* Feeds one received byte to the decoder. Frames with a bad CRC are dropped
+** and the decoder hunts for the next sync byte. After a lost frame it waits
+** for the next keyframe.
+**
+** decoder - decoder structure
+** data    - received byte
+**
+** returns - 1 when the byte completed a frame and decoder->axis holds the
+**           values of its tick, 0 otherwise
+*/
+int tmc26xTelemetryDecodeByte(TMC26XTelemetryDecoder* decoder, uint8_t data) {
+	uint16_t total, crc, i;
+
+	if (decoder->fill == 0 && data != TMC26X_TELEMETRY_SYNC)
+		return 0;
+	decoder->buffer[decoder->fill++] = data;
+
+	while (decoder->fill >= 2) {
+		total = decoder->buffer[1] + 4;
+		if (decoder->buffer[1] < 3 || total > TMC26X_TELEMETRY_MAX_FRAME) {
+			tmc26xTelemetryResync(decoder);
+			continue;
+		}
+		if (decoder->fill < total)
+			return 0;
+
+		crc = 0xFFFF;
+		for (i=1; i<total-2; i++)
+			crc = tmc26xBlobCRC16(crc, decoder->buffer[i]);
+		if (crc != ((uint16_t)decoder->buffer[total-1] << 8 | decoder->buffer[total-2])) {
+			decoder->lost++;
+			decoder->synced = 0;
+			tmc26xTelemetryResync(decoder);
+			continue;
+		}
+
+		decoder->fill = 0;
+		return tmc26xTelemetryApply(decoder);
+	}
+
+	return 0;
+}
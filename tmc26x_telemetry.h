@@ -0,0 +1,77 @@
+// Telemetry stream (one frame per tick, all axes)
+//
+// byte 0   - TMC26X_TELEMETRY_SYNC
+// byte 1   - body length n (bytes 2 .. n+1)
+// byte 2   - sequence number, incremented every frame
+// byte 3   - flags (TMC26X_TELEMETRY_KEYFRAME)
+// byte 4   - number of axes
+// byte 5.. - one record per axis:
+//            header byte (TMC26X_TELEMETRY_..._PRESENT / _DELTA bits), then
+//            SG     - 1 byte signed delta or 2 bytes absolute (big-endian)
+//            MSTEP  - 1 byte signed delta (modulo 1024) or 2 bytes absolute
+//            SE     - 1 byte, only when changed
+//            status - 1 byte, only when changed
+// byte n+2 - CRC16-CCITT (as tmc26x_blob.h) over bytes 1 .. n+1, little-endian
+//
+// Keyframes carry every known value as absolute, and are sent every
+// TMC26X_TELEMETRY_KEYFRAME_INTERVAL frames so a receiver that missed a frame
+// (sequence gap or CRC error) resynchronizes. An axis with nothing new costs
+// one byte; a tick of moving axes is typically 3-4 bytes per axis.
+// At most 36, the body length is one byte
+#ifndef TMC26X_TELEMETRY_MAX_AXES
+#define TMC26X_TELEMETRY_MAX_AXES 8
+#endif
+
+#ifndef TMC26X_TELEMETRY_KEYFRAME_INTERVAL
+#define TMC26X_TELEMETRY_KEYFRAME_INTERVAL 64
+#endif
+
+enum {
+	TMC26X_TELEMETRY_SYNC = 0xA5,
+	TMC26X_TELEMETRY_KEYFRAME = 1,
+	TMC26X_TELEMETRY_MAX_RECORD = 7,
+	TMC26X_TELEMETRY_MAX_FRAME = 5 + TMC26X_TELEMETRY_MAX_AXES * TMC26X_TELEMETRY_MAX_RECORD + 2
+};
+
+// Sample fields (TMC26XTelemetrySample.valid) and record header bits
+enum {
+	TMC26X_TELEMETRY_SG = 1 << 0,
+	TMC26X_TELEMETRY_MSTEP = 1 << 1,
+	TMC26X_TELEMETRY_SE = 1 << 2,
+	TMC26X_TELEMETRY_STATUS = 1 << 3,
+	TMC26X_TELEMETRY_SG_DELTA = 1 << 4,
+	TMC26X_TELEMETRY_MSTEP_DELTA = 1 << 5
+};
+
+typedef struct {
+	uint16_t sg;
+	uint16_t mstep;
+	uint8_t se;
+	uint8_t status;
+	uint8_t valid;      // TMC26X_TELEMETRY_SG .. _STATUS
+} TMC26XTelemetrySample;
+
+typedef struct {
+	TMC26XTelemetrySample last[TMC26X_TELEMETRY_MAX_AXES];
+	uint8_t axes;
+	uint8_t sequence;
+	uint8_t sinceKeyframe;
+} TMC26XTelemetryEncoder;
+
+typedef struct {
+	TMC26XTelemetrySample axis[TMC26X_TELEMETRY_MAX_AXES];
+	uint8_t axes;
+	uint8_t sequence;
+	uint8_t synced;
+	uint16_t lost;          // frames missed or rejected
+	uint8_t buffer[TMC26X_TELEMETRY_MAX_FRAME + TMC26X_TELEMETRY_MAX_RECORD];   // slack for a malformed last record
+	uint16_t fill;
+} TMC26XTelemetryDecoder;
+
+
+int tmc26xReadTelemetry(TMC26XConfiguration* config, TMC26XTelemetrySample* sample);
+void tmc26xTelemetrySampleResponse(TMC26XTelemetrySample* sample, uint8_t readback, uint32_t response);
+void tmc26xTelemetryEncoderInit(TMC26XTelemetryEncoder* encoder, uint8_t axes);
+uint16_t tmc26xTelemetryEncode(TMC26XTelemetryEncoder* encoder, const TMC26XTelemetrySample* samples, uint8_t* out);
+void tmc26xTelemetryDecoderInit(TMC26XTelemetryDecoder* decoder);
+int tmc26xTelemetryDecodeByte(TMC26XTelemetryDecoder* decoder, uint8_t data);
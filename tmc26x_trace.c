@@ -0,0 +1,287 @@
+#ifdef UNIT_TESTING
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <time.h>
+#endif
+#include <stdint.h>
+#include "tmc26x.h"
+#include "tmc26x_trace.h"
+
+/* Serializes one record. Only the fields selected by record->flags are
+** written.
+**
+** record       - record to serialize
+** previousTime - time of the previous record (0 for the first)
+** out          - buffer of at least TMC26X_TRACE_MAX_RECORD bytes
+**
+** returns - the number of bytes written
+*/
+uint8_t tmc26xTraceEncode(const TMC26XTraceRecord* record, uint32_t previousTime, uint8_t* out) {
+	uint32_t delta = record->time - previousTime;
+	uint8_t i = 0;
+
+	out[i++] = record->flags;
+	out[i++] = record->axis;
+
+	while (delta > 0x7F) {
+		out[i++] = 0x80 | (delta & 0x7F);
+		delta >>= 7;
+	}
+	out[i++] = delta;
+
+	if (record->flags & TMC26X_TRACE_COMMAND) {
+		out[i++] = (uint8_t)(record->command >> 16) & 0x0F;
+		out[i++] = (uint8_t)(record->command >> 8);
+		out[i++] = (uint8_t)record->command;
+	}
+	if (record->flags & TMC26X_TRACE_RESPONSE) {
+		out[i++] = (uint8_t)(record->response >> 16) & 0x0F;
+		out[i++] = (uint8_t)(record->response >> 8);
+		out[i++] = (uint8_t)record->response;
+	}
+
+	return i;
+}
+
+/* Parses one record. Fields not present in the record are set to zero.
+**
+** in           - serialized record
+** length       - bytes available in
+** previousTime - time of the previous record (0 for the first)
+** record       - receives the record
+**
+** returns - the number of bytes consumed, 0 if in holds only part of a record
+**           or TMC26X_INVALID_TRACE
+*/
+int tmc26xTraceDecode(const uint8_t* in, uint8_t length, uint32_t previousTime, TMC26XTraceRecord* record) {
+	uint32_t delta = 0;
+	uint8_t i = 2, shift = 0;
+
+	if (length < 3)
+		return 0;
+	if (in[0] & ~(TMC26X_TRACE_COMMAND | TMC26X_TRACE_RESPONSE))
+		return TMC26X_INVALID_TRACE;
+
+	record->flags = in[0];
+	record->axis = in[1];
+
+	do {
+		if (i == length)
+			return 0;
+		if (shift > 28)
+			return TMC26X_INVALID_TRACE;
+		delta |= (uint32_t)(in[i] & 0x7F) << shift;
+		shift += 7;
+	} while (in[i++] & 0x80);
+	record->time = previousTime + delta;
+
+	record->command = 0;
+	record->response = 0;
+	if (record->flags & TMC26X_TRACE_COMMAND) {
+		if (length < i + 3)
+			return 0;
+		record->command = (uint32_t)in[i] << 16 | (uint32_t)in[i+1] << 8 | in[i+2];
+		i += 3;
+	}
+	if (record->flags & TMC26X_TRACE_RESPONSE) {
+		if (length < i + 3)
+			return 0;
+		record->response = (uint32_t)in[i] << 16 | (uint32_t)in[i+1] << 8 | in[i+2];
+		i += 3;
+	}
+
+	return i;
+}
+
+static TMC26XTraceWriter captureWriter;
+static TMC26XTraceClock captureClock;
+static uint32_t captureStart;
+static uint32_t capturePrevious;
+
+// tmc26xFrameHook while capturing
+static void tmc26xTraceCaptureFrame(TMC26XConfiguration* config, uint32_t command, uint32_t response) {
+	uint8_t buffer[TMC26X_TRACE_MAX_RECORD];
+	TMC26XTraceRecord record;
+
+	record.time = captureClock() - captureStart;
+	record.command = command;
+	record.response = response;
+	record.axis = config->axis;
+	record.flags = TMC26X_TRACE_COMMAND | TMC26X_TRACE_RESPONSE;
+
+	captureWriter(buffer, tmc26xTraceEncode(&record, capturePrevious, buffer));
+	capturePrevious = record.time;
+}
+
+/* Starts recording every frame the driver sends, on the firmware SPI path as
+** well as on host builds. Takes over tmc26xFrameHook.
+**
+** writer - receives the header now and then each record as it is sent
+** clock  - time source for the records
+**
+** returns - TMC26X_SUCCESS
+*/
+int tmc26xTraceCaptureStart(TMC26XTraceWriter writer, TMC26XTraceClock clock) {
+	const uint8_t header[TMC26X_TRACE_HEADER_SIZE] = {TMC26X_TRACE_MAGIC0, TMC26X_TRACE_MAGIC1, TMC26X_TRACE_VERSION};
+
+	writer(header, TMC26X_TRACE_HEADER_SIZE);
+
+	captureWriter = writer;
+	captureClock = clock;
+	captureStart = clock();
+	capturePrevious = 0;
+	tmc26xFrameHook = tmc26xTraceCaptureFrame;
+
+	return TMC26X_SUCCESS;
+}
+
+/* Stops recording
+*/
+void tmc26xTraceCaptureStop(void) {
+	tmc26xFrameHook = 0;
+}
+
+#ifdef UNIT_TESTING
+/* Checks the header at the start of a trace file
+**
+** file - trace file opened for reading
+**
+** returns - TMC26X_SUCCESS or TMC26X_INVALID_TRACE
+*/
+int tmc26xTraceReadHeader(FILE* file) {
+	if (fgetc(file) != TMC26X_TRACE_MAGIC0 || fgetc(file) != TMC26X_TRACE_MAGIC1
+	 || fgetc(file) != TMC26X_TRACE_VERSION)
+		return TMC26X_INVALID_TRACE;
+
+	return TMC26X_SUCCESS;
+}
+
+/* Reads the next record of a trace file
+**
+** file         - trace file positioned after the header
+** previousTime - time of the previous record (0 for the first)
+** record       - receives the record
+**
+** returns - 1 if a record was read, 0 at the end of the file or
+**           TMC26X_INVALID_TRACE (also for a truncated last record)
+*/
+int tmc26xTraceReadRecord(FILE* file, uint32_t previousTime, TMC26XTraceRecord* record) {
+	uint8_t buffer[TMC26X_TRACE_MAX_RECORD];
+	uint8_t length = 0, payload = 0;
+	int c;
+
+	// flags, axis and the time delta up to its last byte
+	do {
+		if ((c = fgetc(file)) == EOF)
+			return length ? TMC26X_INVALID_TRACE : 0;
+		buffer[length++] = c;
+	} while (length < 3 || ((c & 0x80) && length < 7));
+
+	if (buffer[0] & TMC26X_TRACE_COMMAND)
+		payload += 3;
+	if (buffer[0] & TMC26X_TRACE_RESPONSE)
+		payload += 3;
+	if (fread(&buffer[length], 1, payload, file) != payload)
+		return TMC26X_INVALID_TRACE;
+	length += payload;
+
+	if (tmc26xTraceDecode(buffer, length, previousTime, record) != length)
+		return TMC26X_INVALID_TRACE;
+
+	return 1;
+}
+
+static FILE* traceFile;
+static TMC26XHostTransport traceDownstream;
+static struct timespec traceStart;
+static uint32_t tracePrevious;
+static uint32_t traceMismatches;
+
+static uint32_t tmc26xTraceNow(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint32_t)((now.tv_sec - traceStart.tv_sec) * 1000000
+		+ (now.tv_nsec - traceStart.tv_nsec) / 1000);
+}
+
+static void tmc26xTraceFileWrite(const uint8_t* data, uint8_t length) {
+	fwrite(data, 1, length, traceFile);
+}
+
+/* Starts recording every frame sent by the driver into a file, through the
+** same hook as tmc26xTraceCaptureStart. The frames go to the downstream
+** transport (an emulator, or tmc26xHostTransport as it was), whose response
+** is recorded and returned.
+**
+** file       - trace file opened for writing, the header is written here
+** downstream - transport that answers the frames
+**
+** returns - TMC26X_SUCCESS
+*/
+int tmc26xTraceRecordStart(FILE* file, TMC26XHostTransport downstream) {
+	traceFile = file;
+	clock_gettime(CLOCK_MONOTONIC, &traceStart);
+	tmc26xHostTransport = downstream;
+
+	return tmc26xTraceCaptureStart(tmc26xTraceFileWrite, tmc26xTraceNow);
+}
+
+/* Stops recording, the downstream transport keeps answering. The file is
+** flushed but left open.
+*/
+void tmc26xTraceRecordStop(void) {
+	tmc26xTraceCaptureStop();
+	fflush(traceFile);
+}
+
+// Answers each frame with the response recorded for it, counting frames that
+// differ from the recording
+static uint32_t tmc26xTracePlaybackTransport(TMC26XConfiguration* config, uint32_t command) {
+	TMC26XTraceRecord record;
+
+	do {
+		if (tmc26xTraceReadRecord(traceFile, tracePrevious, &record) != 1) {
+			traceMismatches++;
+			return 0;
+		}
+		tracePrevious = record.time;
+	} while (!(record.flags & TMC26X_TRACE_COMMAND));
+
+	if (record.command != command || record.axis != config->axis)
+		traceMismatches++;
+
+	return record.response;
+}
+
+/* Replays a trace into a fresh driver instance: every frame the driver sends
+** is checked against the next recorded one and answered with the recorded
+** response, so application code can be rerun against a captured session.
+**
+** file - trace file opened for reading
+**
+** returns - TMC26X_SUCCESS or TMC26X_INVALID_TRACE
+*/
+int tmc26xTracePlaybackStart(FILE* file) {
+	if (tmc26xTraceReadHeader(file) != TMC26X_SUCCESS)
+		return TMC26X_INVALID_TRACE;
+
+	traceFile = file;
+	traceDownstream = tmc26xHostTransport;
+	tracePrevious = 0;
+	traceMismatches = 0;
+	tmc26xHostTransport = tmc26xTracePlaybackTransport;
+
+	return TMC26X_SUCCESS;
+}
+
+/* Ends a playback and restores the previous transport
+**
+** returns - the number of frames that did not match the trace (including
+**           frames sent after it ran out)
+*/
+uint32_t tmc26xTracePlaybackStop(void) {
+	tmc26xHostTransport = traceDownstream;
+	return traceMismatches;
+}
+#endif
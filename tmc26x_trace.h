@@ -0,0 +1,57 @@
+// SPI trace format (big-endian payloads)
+//
+// file header - 'T', 'T', format version (TMC26X_TRACE_VERSION)
+//
+// then one record per frame:
+// byte 0 - direction flags (TMC26X_TRACE_COMMAND, TMC26X_TRACE_RESPONSE)
+// byte 1 - axis
+// byte 2 - microseconds since the previous record, unsigned LEB128 (7 bits
+//          per byte, least significant first, bit 7 set on all but the last)
+// then   - 3 bytes of command if TMC26X_TRACE_COMMAND is set
+// then   - 3 bytes of response if TMC26X_TRACE_RESPONSE is set
+//
+// A frame at the usual polling rate takes 9 or 10 bytes.
+enum {
+	TMC26X_TRACE_MAGIC0 = 'T',
+	TMC26X_TRACE_MAGIC1 = 'T',
+	TMC26X_TRACE_VERSION = 1,
+	TMC26X_TRACE_HEADER_SIZE = 3,
+	TMC26X_TRACE_MAX_RECORD = 2 + 5 + 3 + 3
+};
+
+// Direction flags
+enum {
+	TMC26X_TRACE_COMMAND = 1,    // master to chip payload present
+	TMC26X_TRACE_RESPONSE = 2    // chip to master payload present
+};
+
+typedef struct {
+	uint32_t time;      // microseconds since the trace started
+	uint32_t command;
+	uint32_t response;
+	uint8_t axis;
+	uint8_t flags;
+} TMC26XTraceRecord;
+
+
+// Receives the encoded trace, e.g. a ring buffer drained to a UART. Called
+// from wherever frames are sent, including the emergency stop.
+typedef void (*TMC26XTraceWriter)(const uint8_t* data, uint8_t length);
+
+// Free running microsecond count, may wrap at 32 bits
+typedef uint32_t (*TMC26XTraceClock)(void);
+
+
+uint8_t tmc26xTraceEncode(const TMC26XTraceRecord* record, uint32_t previousTime, uint8_t* out);
+int tmc26xTraceDecode(const uint8_t* in, uint8_t length, uint32_t previousTime, TMC26XTraceRecord* record);
+int tmc26xTraceCaptureStart(TMC26XTraceWriter writer, TMC26XTraceClock clock);
+void tmc26xTraceCaptureStop(void);
+
+#ifdef UNIT_TESTING
+int tmc26xTraceReadHeader(FILE* file);
+int tmc26xTraceReadRecord(FILE* file, uint32_t previousTime, TMC26XTraceRecord* record);
+int tmc26xTraceRecordStart(FILE* file, TMC26XHostTransport downstream);
+void tmc26xTraceRecordStop(void);
+int tmc26xTracePlaybackStart(FILE* file);
+uint32_t tmc26xTracePlaybackStop(void);
+#endif
@@ -0,0 +1,110 @@
+/* Host tool decoding a log of readback responses (32-bit little-endian
+** words as returned by tmc26xReadRaw, all read with the same RDSEL) into
+** column files and summary statistics.
+**
+** Build (SSE2 is used when the compiler targets it, e.g. any x86-64 build):
+**   make tools/tmc26xdecode
+**
+** Usage: tmc26xdecode microstep|stallguard|coolstep log.bin [prefix]
+**   with a prefix, writes prefix.value (16-bit little-endian), prefix.status
+**   and in coolstep mode prefix.se (8-bit).
+*/
+#define _POSIX_C_SOURCE 199309L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_decode.h"
+
+// Words per read, sized to stay in cache
+#define BLOCK 65536
+
+static FILE* openColumn(const char* prefix, const char* column) {
+	char name[1024];
+	FILE* file;
+
+	snprintf(name, sizeof(name), "%s.%s", prefix, column);
+	if (!(file = fopen(name, "wb")))
+		perror(name);
+	return file;
+}
+
+int main(int argc, char** argv) {
+	static uint32_t words[BLOCK];
+	static uint16_t value[BLOCK];
+	static uint8_t se[BLOCK], status[BLOCK];
+	static const char* flagNames[8] = {"SG", "OT", "OTPW", "S2GA", "S2GB", "OLA", "OLB", "STST"};
+	TMC26XDecodeStats stats;
+	FILE *in, *valueFile = 0, *seFile = 0, *statusFile = 0;
+	struct timespec t0, t1;
+	double elapsed = 0;
+	uint8_t readback;
+	size_t n;
+	int i;
+
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s microstep|stallguard|coolstep log.bin [prefix]\n", argv[0]);
+		return 1;
+	}
+	if (!strcmp(argv[1], "microstep"))
+		readback = TMC26X_READBACK_MICROSTEP;
+	else if (!strcmp(argv[1], "stallguard"))
+		readback = TMC26X_READBACK_STALLGUARD;
+	else if (!strcmp(argv[1], "coolstep"))
+		readback = TMC26X_READBACK_COOLSTEP;
+	else {
+		fprintf(stderr, "%s: unknown readback mode\n", argv[1]);
+		return 1;
+	}
+
+	if (!(in = fopen(argv[2], "rb"))) {
+		perror(argv[2]);
+		return 1;
+	}
+	if (argc > 3) {
+		valueFile = openColumn(argv[3], "value");
+		statusFile = openColumn(argv[3], "status");
+		if (readback == TMC26X_READBACK_COOLSTEP)
+			seFile = openColumn(argv[3], "se");
+		if (!valueFile || !statusFile || (readback == TMC26X_READBACK_COOLSTEP && !seFile))
+			return 1;
+	}
+
+	tmc26xDecodeStatsInit(&stats);
+	while ((n = fread(words, sizeof(uint32_t), BLOCK, in)) > 0) {
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		tmc26xDecode(words, n, readback, value, se, status, &stats);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		elapsed += (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+
+		if (valueFile) {
+			fwrite(value, sizeof(uint16_t), n, valueFile);
+			fwrite(status, 1, n, statusFile);
+			if (seFile)
+				fwrite(se, 1, n, seFile);
+		}
+	}
+	fclose(in);
+	if (valueFile) {
+		fclose(valueFile);
+		fclose(statusFile);
+		if (seFile)
+			fclose(seFile);
+	}
+
+	printf("words\t%lu\n", (unsigned long)stats.count);
+	if (stats.count == 0)
+		return 0;
+	printf("value_min_avg_max\t%u\t%.2f\t%u\n", stats.minValue, (double)stats.sumValue / stats.count, stats.maxValue);
+	if (readback == TMC26X_READBACK_COOLSTEP)
+		printf("se_min_avg_max\t%u\t%.2f\t%u\n", stats.minSE, (double)stats.sumSE / stats.count, stats.maxSE);
+	for (i=0; i<8; i++)
+		printf("flag_%s\t%lu\n", flagNames[i], (unsigned long)stats.flags[i]);
+	if (elapsed > 0)
+		printf("decode_MB_per_s\t%.0f\n", stats.count * 4.0 / elapsed / 1e6);
+
+	return 0;
+}
@@ -0,0 +1,69 @@
+/* Host tool converting the built-in profile table into a blob image that can
+** be written to EEPROM/flash and loaded with tmc26xBlobLoadImage.
+**
+** Build (the profile table is selected with the same MOTORDRIVER_ define as
+** the firmware):
+**   make tools/tmc26xmkblob MOTORDRIVER=TMC262
+**
+** Usage: tmc26xmkblob image.bin [profileID ...]
+**   writes every profile, or only the listed profile IDs, back to back.
+*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "tmc26x.h"
+#include "tmc26x_blob.h"
+
+static int selected(int profileID, int argc, char** argv) {
+	int i;
+
+	if (argc < 3)
+		return 1;
+	for (i=2; i<argc; i++)
+		if (atoi(argv[i]) == profileID)
+			return 1;
+
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	uint8_t blob[TMC26X_BLOB_MAX_SIZE];
+	TMC26XProfileStepDirSpreadCycle check;
+	uint16_t length;
+	FILE* out;
+	int i, count = 0;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s image.bin [profileID ...]\n", argv[0]);
+		return 1;
+	}
+
+	if ((out = fopen(argv[1], "wb")) == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	for (i=0; i<tmc26xProfileCount; i++) {
+		if (!selected(profiles[i].profileID, argc, argv))
+			continue;
+
+		length = tmc26xBlobWrite(&profiles[i], blob);
+
+		// Round-trip every blob so a broken image is never written
+		if (tmc26xBlobRead(tmc26xBlobMemoryReader, blob, 0, &check) != TMC26X_SUCCESS
+		 || check.profileID != profiles[i].profileID) {
+			fprintf(stderr, "profile %d failed verification\n", profiles[i].profileID);
+			fclose(out);
+			return 1;
+		}
+
+		fwrite(blob, 1, length, out);
+		printf("profile %d: %u bytes\n", profiles[i].profileID, length);
+		count++;
+	}
+
+	fclose(out);
+	printf("%d profiles written to %s\n", count, argv[1]);
+
+	return count > 0 ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+/* Host tool replaying an SPI trace (see tmc26x_trace.h) into one emulated
+** chip per axis. It reports the bus throughput and timing of the recorded
+** session, the writes per register and the readback interval per axis, and
+** counts responses that differ from the emulator's. Microstep and
+** stallGuard values depend on the motor, so differences are expected for
+** readbacks taken while moving; status bits and coolStep readbacks with
+** coolStep off should match.
+**
+** Traces come from tmc26xTraceCaptureStart on the firmware or
+** tmc26xTraceRecordStart on a host build.
+**
+** Build:
+**   make tools/tmc26xreplay
+**
+** Usage: tmc26xreplay trace.bin [SPI clock in Hz, default 2000000]
+*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_emu.h"
+#include "tmc26x_trace.h"
+
+typedef struct {
+	TMC26XEmulator emu;
+	uint32_t frames;
+	uint32_t readbacks;
+	uint32_t lastReadback;
+	uint32_t maxInterval;
+	uint32_t totalInterval;
+} Axis;
+
+static Axis axes[256];
+static uint8_t used[256];
+
+static const char* registerNames[] = {"DRVCTRL", "CHOPCONF", "SMARTEN", "SGCSCONF", "DRVCONF"};
+
+static uint8_t registerIndex(uint32_t command) {
+	if (!(command & 0x80000))
+		return 0;
+	return ((command >> 17) & 0x03) + 1;
+}
+
+int main(int argc, char** argv) {
+	TMC26XTraceRecord record;
+	FILE* file;
+	uint32_t spiClock = 2000000, previous = 0, first = 0, gap, minGap = 0xFFFFFFFF, maxGap = 0;
+	uint32_t frames = 0, differing = 0, writes[5] = {0}, duration;
+	uint64_t totalGap = 0;
+	Axis* axis;
+	int result, i;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s trace.bin [spi clock Hz]\n", argv[0]);
+		return 1;
+	}
+	if (argc > 2)
+		spiClock = strtoul(argv[2], 0, 0);
+
+	if (!(file = fopen(argv[1], "rb")) || tmc26xTraceReadHeader(file) != TMC26X_SUCCESS) {
+		fprintf(stderr, "%s: not a trace file\n", argv[1]);
+		return 1;
+	}
+
+	while ((result = tmc26xTraceReadRecord(file, previous, &record)) == 1) {
+		axis = &axes[record.axis];
+		if (!used[record.axis]) {
+			tmc26xEmuInit(&axis->emu);
+			used[record.axis] = 1;
+		}
+
+		if (frames == 0)
+			first = record.time;
+		else {
+			gap = record.time - previous;
+			totalGap += gap;
+			if (gap < minGap)
+				minGap = gap;
+			if (gap > maxGap)
+				maxGap = gap;
+		}
+		previous = record.time;
+		frames++;
+		axis->frames++;
+
+		if (!(record.flags & TMC26X_TRACE_COMMAND))
+			continue;
+
+		writes[registerIndex(record.command)]++;
+		if ((tmc26xEmuTransfer(&axis->emu, record.command) != record.response)
+		 && (record.flags & TMC26X_TRACE_RESPONSE))
+			differing++;
+
+		// Each DRVCONF frame is a readback (tmc26xReadback)
+		if (registerIndex(record.command) == 4) {
+			if (axis->readbacks) {
+				gap = record.time - axis->lastReadback;
+				axis->totalInterval += gap;
+				if (gap > axis->maxInterval)
+					axis->maxInterval = gap;
+			}
+			axis->lastReadback = record.time;
+			axis->readbacks++;
+		}
+	}
+	fclose(file);
+
+	if (result < 0) {
+		fprintf(stderr, "%s: truncated or corrupt after %lu frames\n", argv[1], (unsigned long)frames);
+		return 1;
+	}
+	if (frames == 0) {
+		printf("empty trace\n");
+		return 0;
+	}
+
+	duration = previous - first;
+	printf("frames\t%lu\n", (unsigned long)frames);
+	printf("duration_us\t%lu\n", (unsigned long)duration);
+	if (duration) {
+		printf("frames_per_s\t%.1f\n", frames * 1e6 / duration);
+		// 24 clocks per frame
+		printf("bus_utilisation\t%.4f\n", frames * 24.0 * 1e6 / spiClock / duration);
+	}
+	if (frames > 1)
+		printf("gap_us_min_avg_max\t%lu\t%.1f\t%lu\n", (unsigned long)minGap,
+			(double)totalGap / (frames - 1), (unsigned long)maxGap);
+	for (i=0; i<5; i++)
+		printf("writes_%s\t%lu\n", registerNames[i], (unsigned long)writes[i]);
+	printf("responses_differing\t%lu\n", (unsigned long)differing);
+
+	for (i=0; i<256; i++) {
+		if (!used[i])
+			continue;
+		axis = &axes[i];
+		printf("axis %d\tframes %lu\treadbacks %lu", i, (unsigned long)axis->frames, (unsigned long)axis->readbacks);
+		if (axis->readbacks > 1)
+			printf("\tinterval_us_avg_max %.1f %lu", (double)axis->totalInterval / (axis->readbacks - 1),
+				(unsigned long)axis->maxInterval);
+		printf("\tregs %05lX %05lX %05lX %05lX %05lX\n", (unsigned long)axis->emu.DRVCTRL,
+			(unsigned long)axis->emu.CHOPCONF, (unsigned long)axis->emu.SMARTEN,
+			(unsigned long)axis->emu.SGCSCONF, (unsigned long)axis->emu.DRVCONF);
+	}
+
+	return 0;
+}
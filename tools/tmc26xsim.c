@@ -0,0 +1,277 @@
+/* Host simulation of many axes, for sizing how many drivers one SPI bus and
+** one CPU can service. Every axis runs the real driver against its own
+** emulated chip (tmc26x_emu) and motor (tmc26x_plant). Each time slice the
+** axes take one stallGuard2 sample and then move for the rest of the slice.
+** The slices are spread over worker threads with a work-stealing scheduler.
+** Between slices the frames each axis sent are laid out on its bus in
+** order, which gives the bus utilisation and the time from the start of the
+** slice until each sample has been clocked in.
+**
+** Build:
+**   make tools/tmc26xsim RSENSE_VALUE=100
+**
+** Usage: tmc26xsim [max axes] [threads] [axes per bus] [SPI clock Hz] [slice us] [duration s]
+**   defaults 512, 4, 8, 2000000, 1000, 0.1
+**
+** The axis count doubles from 8 up to max axes, one tab separated line each:
+**   axes buses threads bus_load latency_us_avg latency_us_max
+**   frames_per_axis_s driver_us_per_axis_s plant_us_per_axis_s wall_s
+** bus_load is the bus time asked for over the time simulated; above 1 the
+** bus cannot keep up and the latency grows with the run length.
+** The driver and plant CPU times are thread CPU time per axis per simulated
+** second (including the clock reads around each call); the driver figure is
+** what the firmware would spend, scaled by the host to target speed ratio.
+*/
+#define _POSIX_C_SOURCE 200112L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_emu.h"
+#include "tmc26x_plant.h"
+
+// Axes handed out per task
+#define CHUNK 4
+#define MAX_THREADS 64
+
+typedef struct {
+	TMC26XConfiguration config;    // first, the transport casts back to the axis
+	TMC26XEmulator emu;
+	TMC26XPlant plant;
+	float stepRate;
+	uint32_t frames;               // frames sent this slice
+	uint64_t totalFrames;
+	double driverTime;
+	double plantTime;
+} SimAxis;
+
+// Task deque: the owner pops from the bottom, thieves take from the top
+typedef struct {
+	pthread_mutex_t lock;
+	int* tasks;
+	int top;
+	int bottom;
+} Deque;
+
+static SimAxis* axes;
+static int axisCount, threadCount;
+static float slice;
+static Deque deques[MAX_THREADS];
+static pthread_barrier_t sliceStart, sliceEnd;
+static volatile int running;
+
+static uint32_t simTransport(TMC26XConfiguration* config, uint32_t command) {
+	SimAxis* axis = (SimAxis*)config;
+
+	axis->frames++;
+	return tmc26xEmuTransfer(&axis->emu, command);
+}
+
+static double cpuTime(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double wallTime(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void setupAxis(SimAxis* axis, int index) {
+	int profileID = profiles[index % tmc26xProfileCount].profileID;
+
+	tmc26xEmuInit(&axis->emu);
+	TMC26XConfiguration_Init(&axis->config);
+	initializeTMC26XWithProfile(&axis->config, profileID);
+	tmc26xDRVCTRLSetMicrostepResolution(&axis->config, 16);
+	tmc26xSetDrivingCurrent(&axis->config);
+
+	tmc26xPlantInit(&axis->plant, profileID, RSENSE_VALUE / 1000.0f, 24);
+	axis->plant.loadTorque = axis->plant.motor->holdingTorque * (index % 5) / 20;
+	// 1 to 3 revolutions per second at 16 microsteps
+	axis->stepRate = 3200 * (1 + index % 3);
+
+	axis->frames = 0;
+	axis->totalFrames = 0;
+	axis->driverTime = 0;
+	axis->plantTime = 0;
+}
+
+static void runAxis(SimAxis* axis) {
+	double t0, t1, t2;
+
+	t0 = cpuTime();
+	tmc26xReadStallGuardValue(&axis->config);
+	t1 = cpuTime();
+	tmc26xPlantMove(&axis->plant, &axis->emu, axis->stepRate, slice);
+	t2 = cpuTime();
+
+	axis->driverTime += t1 - t0;
+	axis->plantTime += t2 - t1;
+}
+
+static int takeTask(int self) {
+	Deque* deque;
+	int task = -1, i;
+
+	deque = &deques[self];
+	pthread_mutex_lock(&deque->lock);
+	if (deque->bottom > deque->top)
+		task = deque->tasks[--deque->bottom];
+	pthread_mutex_unlock(&deque->lock);
+
+	for (i=1; task < 0 && i<threadCount; i++) {
+		deque = &deques[(self + i) % threadCount];
+		pthread_mutex_lock(&deque->lock);
+		if (deque->bottom > deque->top)
+			task = deque->tasks[deque->top++];
+		pthread_mutex_unlock(&deque->lock);
+	}
+
+	return task;
+}
+
+static void* worker(void* arg) {
+	int self = (int)(intptr_t)arg;
+	int task, i, end;
+
+	for (;;) {
+		pthread_barrier_wait(&sliceStart);
+		if (!running)
+			return 0;
+
+		while ((task = takeTask(self)) >= 0) {
+			end = (task + 1) * CHUNK < axisCount ? (task + 1) * CHUNK : axisCount;
+			for (i=task*CHUNK; i<end; i++)
+				runAxis(&axes[i]);
+		}
+
+		pthread_barrier_wait(&sliceEnd);
+	}
+}
+
+static void simulate(int count, int axesPerBus, float spiClock, float duration) {
+	pthread_t threads[MAX_THREADS];
+	int buses = (count + axesPerBus - 1) / axesPerBus;
+	int tasks = (count + CHUNK - 1) / CHUNK;
+	int slices = (int)(duration / slice + 0.5f);
+	double* busFree = calloc(buses, sizeof(double));
+	double frameTime = 24 / spiClock, busy = 0, latency, latencySum = 0, latencyMax = 0;
+	double driver = 0, plant = 0, start, now;
+	uint64_t frames = 0, samples = 0;
+	int i, s, b;
+
+	axisCount = count;
+	for (i=0; i<count; i++)
+		setupAxis(&axes[i], i);
+	for (i=0; i<threadCount; i++) {
+		deques[i].tasks = malloc(tasks * sizeof(int));
+		pthread_mutex_init(&deques[i].lock, 0);
+	}
+
+	pthread_barrier_init(&sliceStart, 0, threadCount + 1);
+	pthread_barrier_init(&sliceEnd, 0, threadCount + 1);
+	running = 1;
+	for (i=0; i<threadCount; i++)
+		pthread_create(&threads[i], 0, worker, (void*)(intptr_t)i);
+
+	start = wallTime();
+	for (s=0; s<slices; s++) {
+		// Deal the tasks out round robin, stealing evens out the rest
+		for (i=0; i<threadCount; i++)
+			deques[i].top = deques[i].bottom = 0;
+		for (i=0; i<tasks; i++)
+			deques[i % threadCount].tasks[deques[i % threadCount].bottom++] = i;
+
+		pthread_barrier_wait(&sliceStart);
+		pthread_barrier_wait(&sliceEnd);
+
+		// Serialize each bus in axis order, carrying over any backlog
+		for (b=0; b<buses; b++) {
+			now = s * (double)slice;
+			if (busFree[b] > now)
+				now = busFree[b];
+			for (i=b*axesPerBus; i<count && i<(b+1)*axesPerBus; i++) {
+				now += axes[i].frames * frameTime;
+				busy += axes[i].frames * frameTime;
+				latency = now - s * (double)slice;
+				latencySum += latency;
+				if (latency > latencyMax)
+					latencyMax = latency;
+				samples++;
+				axes[i].totalFrames += axes[i].frames;
+				axes[i].frames = 0;
+			}
+			busFree[b] = now;
+		}
+	}
+	now = wallTime() - start;
+
+	running = 0;
+	pthread_barrier_wait(&sliceStart);
+	for (i=0; i<threadCount; i++)
+		pthread_join(threads[i], 0);
+	pthread_barrier_destroy(&sliceStart);
+	pthread_barrier_destroy(&sliceEnd);
+
+	for (i=0; i<count; i++) {
+		frames += axes[i].totalFrames;
+		driver += axes[i].driverTime;
+		plant += axes[i].plantTime;
+	}
+	duration = slices * slice;
+
+	printf("%d\t%d\t%d\t%.4f\t%.1f\t%.1f\t%.1f\t%.2f\t%.1f\t%.3f\n", count, buses, threadCount,
+		busy / (buses * duration), latencySum / samples * 1e6, latencyMax * 1e6,
+		frames / (count * duration), driver / (count * duration) * 1e6,
+		plant / (count * duration) * 1e6, now);
+
+	for (i=0; i<threadCount; i++) {
+		free(deques[i].tasks);
+		pthread_mutex_destroy(&deques[i].lock);
+	}
+	free(busFree);
+}
+
+int main(int argc, char** argv) {
+	int maxAxes = 512, axesPerBus = 8, count;
+	float spiClock = 2000000, duration = 0.1f;
+
+	threadCount = 4;
+	slice = 1e-3f;
+	if (argc > 1)
+		maxAxes = atoi(argv[1]);
+	if (argc > 2)
+		threadCount = atoi(argv[2]);
+	if (argc > 3)
+		axesPerBus = atoi(argv[3]);
+	if (argc > 4)
+		spiClock = atof(argv[4]);
+	if (argc > 5)
+		slice = atof(argv[5]) * 1e-6f;
+	if (argc > 6)
+		duration = atof(argv[6]);
+	if (maxAxes < 1 || threadCount < 1 || threadCount > MAX_THREADS || axesPerBus < 1
+	 || spiClock <= 0 || slice <= 0 || duration < slice) {
+		fprintf(stderr, "usage: %s [max axes] [threads] [axes per bus] [SPI clock Hz] [slice us] [duration s]\n", argv[0]);
+		return 1;
+	}
+
+	tmc26xHostTransport = simTransport;
+	axes = malloc(maxAxes * sizeof(SimAxis));
+
+	printf("# axes\tbuses\tthreads\tbus_load\tlatency_us_avg\tlatency_us_max\tframes_per_axis_s\tdriver_us_per_axis_s\tplant_us_per_axis_s\twall_s\n");
+	for (count=8; count<maxAxes; count*=2)
+		simulate(count, axesPerBus, spiClock, duration);
+	simulate(maxAxes, axesPerBus, spiClock, duration);
+
+	free(axes);
+	return 0;
+}
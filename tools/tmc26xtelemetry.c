@@ -0,0 +1,55 @@
+/* Host decoder for the telemetry stream (tmc26x_telemetry.h), e.g. captured
+** from the UART or piped from a serial port. Prints one tab separated line
+** per axis and frame; values never received are printed as -.
+**
+** Build:
+**   make tools/tmc26xtelemetry
+**
+** Usage: tmc26xtelemetry [stream.bin]   (standard input without a file)
+**   seq axis sg mstep se status
+*/
+#include <stdint.h>
+#include <stdio.h>
+#include "tmc26x.h"
+#include "tmc26x_telemetry.h"
+
+static void printField(uint8_t valid, uint8_t field, unsigned value) {
+	if (valid & field)
+		printf("\t%u", value);
+	else
+		printf("\t-");
+}
+
+int main(int argc, char** argv) {
+	TMC26XTelemetryDecoder decoder;
+	TMC26XTelemetrySample* sample;
+	FILE* in = stdin;
+	uint8_t axis;
+	int c;
+
+	if (argc > 1 && !(in = fopen(argv[1], "rb"))) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	tmc26xTelemetryDecoderInit(&decoder);
+	printf("# seq\taxis\tsg\tmstep\tse\tstatus\n");
+	while ((c = fgetc(in)) != EOF) {
+		if (!tmc26xTelemetryDecodeByte(&decoder, c))
+			continue;
+		for (axis=0; axis<decoder.axes; axis++) {
+			sample = &decoder.axis[axis];
+			printf("%u\t%u", decoder.sequence, axis);
+			printField(sample->valid, TMC26X_TELEMETRY_SG, sample->sg);
+			printField(sample->valid, TMC26X_TELEMETRY_MSTEP, sample->mstep);
+			printField(sample->valid, TMC26X_TELEMETRY_SE, sample->se);
+			if (sample->valid & TMC26X_TELEMETRY_STATUS)
+				printf("\t%02X\n", sample->status);
+			else
+				printf("\t-\n");
+		}
+	}
+
+	fprintf(stderr, "frames lost: %u\n", decoder.lost);
+	return 0;
+}
@@ -1,9 +1,78 @@
 #include <stdint.h>
+#include <stdio.h>
 #include "tmc26x.h"
+#include "tmc26x_regs.h"
+#include "tmc26x_emu.h"
+#include "tmc26x_queue.h"
 
 TMC26XConfiguration config;
 
+static TMC26XEmulator emu;
+static uint32_t peakCurrent;
+
+/* Full-scale sense voltage times (CS + 1) the emulated chip is set to, in
+** mV/32, proportional to the motor current
+*/
+static uint32_t emuCurrent(void) {
+	return (uint32_t)((emu.DRVCONF & TMC26X_DRVCONF_VSENSE_BITMASK) ? TMC26X_VSENSE_HALFISH : TMC26X_VSENSE_FULL) * ((emu.SGCSCONF & 0x1F) + 1);
+}
+
+// Host transport into the emulator, keeping the highest current it was set to
+static uint32_t emuTransport(TMC26XConfiguration* config, uint32_t command) {
+	uint32_t response;
+
+	(void)config;
+	response = tmc26xEmuTransfer(&emu, command);
+	if (emuCurrent() > peakCurrent)
+		peakCurrent = emuCurrent();
+	return response;
+}
+
+/* A CS-only change queued behind a current drop must not move the pending
+** SGCSCONF behind DRVCONF: 165 mV/CS 31, then 305 mV/CS 10 (SGCSCONF first),
+** then CS 20. The chip may never run above the first or the last setting.
+**
+** returns - 0 on success
+*/
+static int testQueuePairOrder(void) {
+	TMC26XQueue queue;
+	uint32_t limit;
+	uint16_t now = 0;
+
+	tmc26xEmuInit(&emu);
+	tmc26xHostTransport = emuTransport;
+
+	initializeTMC26XWithProfile(&config, MOTOR_LG_23HS7430);
+	tmc26xSGCSCONFSetCurrentScale(&config, 31);
+	tmc26xDRVCONFSetMaximumRSenseVoltage(&config, TMC26X_VSENSE_HALFISH);
+	tmc26xCommitConfiguration(&config, 1);
+	peakCurrent = emuCurrent();
+	limit = peakCurrent;
+
+	tmc26xQueueInit(&queue);
+	tmc26xSGCSCONFSetCurrentScale(&config, 10);
+	tmc26xDRVCONFSetMaximumRSenseVoltage(&config, TMC26X_VSENSE_FULL);
+	tmc26xQueueCommit(&queue, TMC26X_QUEUE_MOTION, &config, 1, now);
+	tmc26xSGCSCONFSetCurrentScale(&config, 20);
+	tmc26xQueueCommit(&queue, TMC26X_QUEUE_MOTION, &config, 0, now);
+	while (tmc26xQueueService(&queue, ++now));
+
+	if (emuCurrent() > limit)
+		limit = emuCurrent();
+	if (emu.SGCSCONF != config.regSGCSCONF || emu.DRVCONF != config.regDRVCONF || peakCurrent > limit) {
+		printf("queue pair order: peak %lu, limit %lu\n", (unsigned long)peakCurrent, (unsigned long)limit);
+		return 1;
+	}
+	return 0;
+}
+
 int main() {
+	int failures = 0;
+
 	TMC26XConfiguration_Init(&config);
 	initializeTMC26XWithProfile(&config, MOTOR_LG_23HS7430);
+
+	failures += testQueuePairOrder();
+
+	return failures != 0;
 }